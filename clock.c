@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/times.h>
 #include "clock.h"
@@ -16,60 +17,153 @@
 /******************************************************* 
  * Machine dependent functions 
  *
- * Note: the constants __i386__ and  __alpha
+ * Note: the constants __i386__, __x86_64__ and  __alpha
  * are set by GCC when it calls the C preprocessor
  * You can verify this for yourself using gcc -v.
  *******************************************************/
 
-#if defined(__i386__)  
+#if defined(__i386__) || defined(__x86_64__)
 /*******************************************************
- * Pentium versions of start_counter() and get_counter()
+ * x86 versions of start_counter() and get_counter()
+ *
+ * The time stamp counter is read serialized: "lfence; rdtsc" at the
+ * start so earlier instructions retire before the read, and "rdtscp;
+ * lfence" at the end so the timed code finishes before it and later
+ * code cannot start ahead of it. This only counts time if the TSC is
+ * invariant (constant rate, keeps ticking in deep C-states); if it
+ * isn't, the counter falls back to CLOCK_MONOTONIC_RAW in ns.
  *******************************************************/
+#include <time.h>
+#include <cpuid.h>
+
+/* Counter source, set on first use by tsc_probe() */
+#define CNT_UNKNOWN -1
+#define CNT_RAW      0   /* CLOCK_MONOTONIC_RAW, 1 tick = 1 ns */
+#define CNT_TSC      1   /* invariant TSC */
+
+static int cnt_source = CNT_UNKNOWN;
+static int has_rdtscp = 0;
+static unsigned long long cyc_start = 0;
+
+/* Decide which counter to use. CPUID 0x80000007 EDX[8] is the invariant
+   TSC bit; hypervisors often hide it, so a TSC the kernel already uses
+   as its clocksource is trusted as well. */
+static void tsc_probe(void)
+{
+    unsigned a, b, c, d;
+    FILE *fp;
+    char buf[32];
+
+    cnt_source = CNT_RAW;
+    if (__get_cpuid(0x80000001, &a, &b, &c, &d))
+	has_rdtscp = (d >> 27) & 1;
+    if (__get_cpuid(0x80000007, &a, &b, &c, &d) && (d & (1u << 8)))
+	cnt_source = CNT_TSC;
+    else if ((fp = fopen("/sys/devices/system/clocksource/clocksource0/"
+			 "current_clocksource", "r")) != NULL) {
+	if (fgets(buf, sizeof(buf), fp) && strncmp(buf, "tsc", 3) == 0)
+	    cnt_source = CNT_TSC;
+	fclose(fp);
+    }
+}
 
+/* TSC read that opens a timed region */
+static inline unsigned long long tsc_begin(void)
+{
+    unsigned hi, lo;
+    __asm__ volatile ("lfence; rdtsc" : "=a" (lo), "=d" (hi) :: "memory");
+    return ((unsigned long long) hi << 32) | lo;
+}
 
-/* $begin x86cyclecounter */
-/* Initialize the cycle counter */
-static unsigned cyc_hi = 0;
-static unsigned cyc_lo = 0;
+/* TSC read that closes a timed region */
+static inline unsigned long long tsc_end(void)
+{
+    unsigned hi, lo;
+    if (has_rdtscp)
+	__asm__ volatile ("rdtscp; lfence" : "=a" (lo), "=d" (hi) :: "%ecx", "memory");
+    else
+	__asm__ volatile ("lfence; rdtsc; lfence" : "=a" (lo), "=d" (hi) :: "memory");
+    return ((unsigned long long) hi << 32) | lo;
+}
 
+static unsigned long long raw_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
-/* Set *hi and *lo to the high and low order bits  of the cycle counter.  
-   Implementation requires assembly code to use the rdtsc instruction. */
+/* Set *hi and *lo to the high and low order bits of the cycle counter. */
 void access_counter(unsigned *hi, unsigned *lo)
 {
-    asm("rdtsc; movl %%edx,%0; movl %%eax,%1"   /* Read cycle counter */
-	: "=r" (*hi), "=r" (*lo)                /* and move results to */
-	: /* No input */                        /* the two outputs */
-	: "%edx", "%eax");
+    unsigned long long t = tsc_begin();
+    *hi = (unsigned) (t >> 32);
+    *lo = (unsigned) t;
 }
 
 /* Record the current value of the cycle counter. */
 void start_counter()
 {
-    access_counter(&cyc_hi, &cyc_lo);
+    if (cnt_source == CNT_UNKNOWN)
+	tsc_probe();
+    cyc_start = (cnt_source == CNT_TSC) ? tsc_begin() : raw_ns();
 }
 
 /* Return the number of cycles since the last call to start_counter. */
 double get_counter()
 {
-    unsigned ncyc_hi, ncyc_lo;
-    unsigned hi, lo, borrow;
-    double result;
+    unsigned long long now = (cnt_source == CNT_TSC) ? tsc_end() : raw_ns();
+    return (double) (now - cyc_start);
+}
 
-    /* Get cycle counter */
-    access_counter(&ncyc_hi, &ncyc_lo);
+/* Counter rate in MHz. CPUID leaf 0x15 gives the TSC frequency exactly
+   when the CPU reports its crystal clock; otherwise count TSC ticks
+   against CLOCK_MONOTONIC_RAW, which is a few ms instead of the 2 s
+   sleep in mhz_full() and doesn't care about frequency scaling. */
+static double counter_mhz(int verbose)
+{
+    unsigned a, b, c, d;
+    unsigned long long t0, t1, c0, c1;
+    double rate;
+    int i;
 
-    /* Do double precision subtraction */
-    lo = ncyc_lo - cyc_lo;
-    borrow = lo > ncyc_lo;
-    hi = ncyc_hi - cyc_hi - borrow;
-    result = (double) hi * (1 << 30) * 4 + lo;
-    if (result < 0) {
-	fprintf(stderr, "Error: counter returns neg value: %.0f\n", result);
+    if (cnt_source == CNT_UNKNOWN)
+	tsc_probe();
+    if (cnt_source == CNT_RAW) {
+	if (verbose)
+	    printf("TSC is not invariant, counting CLOCK_MONOTONIC_RAW ns\n");
+	return 1000.0;
     }
-    return result;
+    if (__get_cpuid_max(0, NULL) >= 0x15) {
+	__cpuid(0x15, a, b, c, d);
+	if (a && b && c) {
+	    rate = (double) c * b / a / 1e6;
+	    if (verbose)
+		printf("Invariant TSC at %.1f MHz (CPUID)\n", rate);
+	    return rate;
+	}
+    }
+
+    /* Best of 3 short windows; a preemption between the paired
+       reads can only make a window look slower, never faster */
+    rate = 0;
+    for (i = 0; i < 3; i++) {
+	struct timespec req = {0, 20 * 1000000};
+	double r;
+
+	t0 = raw_ns();
+	c0 = tsc_begin();
+	nanosleep(&req, NULL);
+	c1 = tsc_end();
+	t1 = raw_ns();
+	r = (double) (c1 - c0) * 1e3 / (t1 - t0);
+	if (r > rate)
+	    rate = r;
+    }
+    if (verbose)
+	printf("Invariant TSC at %.1f MHz (measured)\n", rate);
+    return rate;
 }
-/* $end x86cyclecounter */
 
 #elif defined(__alpha)
 
@@ -198,7 +292,11 @@ double mhz_full(int verbose, int sleeptime)
 /* Version using a default sleeptime */
 double mhz(int verbose)
 {
+#if defined(__i386__) || defined(__x86_64__)
+    return counter_mhz(verbose);
+#else
     return mhz_full(verbose, 2);
+#endif
 }
 
 /** Special counters that compensate for timer interrupt overhead */
@@ -9,7 +9,8 @@ double get_counter();
 /* Measure overhead for counter */
 double ovhd();
 
-/* Determine clock rate of processor (using a default sleeptime) */
+/* Determine clock rate of processor (on x86, the rate of the counter
+   start_counter() reads: invariant TSC, or 1000 for ns) */
 double mhz(int verbose);
 
 /* Determine clock rate of processor, having more control over accuracy */
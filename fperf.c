@@ -0,0 +1,156 @@
+/*
+ * fperf.c - Estimate the time (in seconds) used by a function f with
+ *     the Linux perf_event_open counters, and count hardware events
+ *     (cycles, instructions, cache, TLB and branch misses) around it.
+ *
+ * Each event is opened as its own counter rather than as one group, so
+ * that a PMU with fewer counters than events still counts all of them
+ * by multiplexing; fperf scales each count by time enabled / time
+ * running. Only user-level events of the calling thread are counted,
+ * which perf_event_paranoid <= 2 allows without privileges.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "fperf.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/* perf_event_attr type and config of each FPERF_* event */
+static const struct {
+    unsigned type;
+    unsigned long long config;
+    char *name;
+} events[FPERF_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D), "L1D misses"},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL), "LLC misses"},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB), "dTLB misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch misses"},
+};
+#endif
+
+static int fds[FPERF_EVENTS];    /* counter of each event, -1 if not counted */
+static int clock_fd = -1;        /* task clock (ns), -1 if not available */
+static double last[FPERF_EVENTS];
+static int initialized = 0;
+
+#ifdef __linux__
+/* open one disabled, user-only counter for this thread */
+static int open_counter(unsigned type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* read a counter, scaled for the time it was multiplexed out; -1 if it
+   never ran */
+static double read_counter(int fd)
+{
+    unsigned long long v[3]; /* value, time enabled, time running */
+
+    if (fd < 0 || read(fd, v, sizeof(v)) != sizeof(v) || v[2] == 0)
+	return -1;
+    return (double)v[0] * ((double)v[1] / (double)v[2]);
+}
+#endif
+
+/*
+ * fperf_init - open the counters once; report the ones that are missing
+ */
+int fperf_init(int verbose)
+{
+    int i, n = 0;
+
+    if (initialized)
+	goto done;
+    initialized = 1;
+    for (i = 0; i < FPERF_EVENTS; i++)
+	fds[i] = -1;
+#ifdef __linux__
+    clock_fd = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+    for (i = 0; i < FPERF_EVENTS; i++) {
+	fds[i] = open_counter(events[i].type, events[i].config);
+	if (fds[i] < 0 && verbose)
+	    printf("perf_event_open: %s not available\n", events[i].name);
+    }
+#endif
+    if (clock_fd < 0 && verbose)
+	printf("perf_event_open: no task clock, timing with the wall clock\n");
+
+done:
+    for (i = 0; i < FPERF_EVENTS; i++)
+	n += (fds[i] >= 0);
+    return clock_fd < 0 && n == 0 ? -1 : n;
+}
+
+/* 
+ * fperf - Use the task clock to estimate the running time of f(argp),
+ * counting the hardware events at the same time. Return the average
+ * of n runs.
+ */
+double fperf(fperf_test_funct f, void *argp, int n)
+{
+    struct timespec start, end;
+    double secs, ns;
+    int i;
+
+    fperf_init(0);
+#ifdef __linux__
+    for (i = 0; i < FPERF_EVENTS; i++)
+	if (fds[i] >= 0) {
+	    ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    if (clock_fd >= 0) {
+	ioctl(clock_fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(clock_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < n; i++)
+	f(argp);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    for (i = 0; i < FPERF_EVENTS; i++)
+	last[i] = -1;
+#ifdef __linux__
+    if (clock_fd >= 0) {
+	ioctl(clock_fd, PERF_EVENT_IOC_DISABLE, 0);
+	if ((ns = read_counter(clock_fd)) >= 0)
+	    secs = 1e-9 * ns;
+    }
+    for (i = 0; i < FPERF_EVENTS; i++)
+	if (fds[i] >= 0) {
+	    ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	    last[i] = read_counter(fds[i]);
+	    if (last[i] >= 0)
+		last[i] /= n;
+	}
+#endif
+    return secs / n;
+}
+
+void fperf_last(double counts[FPERF_EVENTS])
+{
+    memcpy(counts, last, sizeof(last));
+}
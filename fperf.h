@@ -0,0 +1,28 @@
+/*
+ * Function timer with hardware event counters (Linux perf_event_open)
+ */
+typedef void (*fperf_test_funct)(void *);
+
+/* The events counted around each measurement, in fperf_last order */
+enum {
+    FPERF_CYCLES,
+    FPERF_INSTRUCTIONS,
+    FPERF_L1D_MISSES,   /* L1 data cache read misses */
+    FPERF_LLC_MISSES,   /* last level cache read misses */
+    FPERF_DTLB_MISSES,  /* data TLB read misses */
+    FPERF_BRANCH_MISSES,
+    FPERF_EVENTS
+};
+
+/* Open the counters. Returns the number of hardware events that can be
+   counted here (VMs often have none), or -1 if perf_event_open cannot
+   be used at all, in which case fperf falls back to wall-clock time */
+int fperf_init(int verbose);
+
+/* Estimate the running time of f(argp) from the task clock (CPU time
+   of this thread). Return the average of n runs */
+double fperf(fperf_test_funct f, void *argp, int n);
+
+/* The events per run counted by the last fperf call, scaled up if the
+   kernel had to multiplex the counters; -1 for events not counted */
+void fperf_last(double counts[FPERF_EVENTS]);
@@ -6,6 +6,7 @@
 #include "fcyc.h"
 #include "clock.h"
 #include "ftimer.h"
+#include "fperf.h"
 #include "config.h"
 
 static double Mhz;  /* estimated CPU clock frequency */
@@ -26,7 +27,15 @@ void init_fsecs(void)
     /* set key parameters for the fcyc package */
     set_fcyc_maxsamples(20); 
     set_fcyc_clear_cache(1);
+#if defined(__i386__) || defined(__x86_64__)
+    /* The x86 counter is the invariant TSC or CLOCK_MONOTONIC_RAW ns:
+       wall time at a fixed rate, against which times()' tick-based
+       correction is miscalibrated and can drive the K best samples
+       negative */
+    set_fcyc_compensate(0);
+#else
     set_fcyc_compensate(1);
+#endif
     set_fcyc_epsilon(0.01);
     set_fcyc_k(3);
     Mhz = mhz(verbose > 0);
@@ -36,6 +45,10 @@ void init_fsecs(void)
 #elif USE_GETTOD
     if (verbose)
 	printf("Measuring performance with gettimeofday().\n");
+#elif USE_PERF
+    if (verbose)
+	printf("Measuring performance with perf_event_open counters.\n");
+    fperf_init(verbose > 0);
 #endif
 }
 
@@ -51,6 +64,8 @@ double fsecs(fsecs_test_funct f, void *argp)
     return ftimer_itimer(f, argp, 10);
 #elif USE_GETTOD
     return ftimer_gettod(f, argp, 10);
+#elif USE_PERF
+    return fperf(f, argp, 10);
 #endif 
 }
 
@@ -7,20 +7,28 @@
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
  */
+#define _GNU_SOURCE      /* sched_setaffinity and the CPU_* macros */
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <sched.h>
+#include <dlfcn.h>
 #include <errno.h>
 #include <string.h>
 #include <assert.h>
 #include <float.h>
+#include <math.h>
 #include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
 
 extern char *optarg; // Added declaration for optarg
 
 #include "mm.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "fperf.h"
 #include "config.h"
 
 /**********************
@@ -32,9 +40,28 @@ extern char *optarg; // Added declaration for optarg
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
+/* Result formats (--format) */
+#define FMT_TEXT 0
+#define FMT_JSON 1
+#define FMT_CSV  2
+
+/* Long-only options */
+#define OPT_FORMAT         256
+#define OPT_BASELINE       257
+#define OPT_THRU_THRESHOLD 258
+#define OPT_UTIL_THRESHOLD 259
+
+#define MAX_METRICS 64   /* extended metrics per trace in the results */
+#define MAX_PLUGINS 128  /* allocators per -A list */
+#define PLUGIN_COLUMNS 8 /* up to this many, -A prints them side by side */
+
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
 
+/* The byte the payload of id index is filled with in the validity
+   checks; each -j worker shifts it by its own fill_salt */
+#define FILL(index) ((char)(((index) + fill_salt) & 0xFF))
+
 /****************************** 
  * The key compound data types 
  *****************************/
@@ -62,8 +89,57 @@ typedef struct {
     traceop_t *ops;      /* array of requests */
     char **blocks;       /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    int num_regions;     /* number of regions named by "g" annotations */
+    int *region_of;      /* region of each id, or -1 if none */
+    mm_region_t **regions; /* regions created while running the trace... */
+    int *region_live;    /* ... and the number of live ids in each */
+    mm_region_t **spare_regions; /* reset regions waiting for reuse */
+    int num_spare;       /* number of entries in spare_regions */
+    mm_handle_t *handles; /* handle of each live id, or 0 (-K) */
+    mm_pool_t **pools;   /* pool for each request size up to pool_max (-O) */
 } trace_t;
 
+/* The pools of one trace after its util pass, added up (-O) */
+typedef struct {
+    int pools;           /* pools created */
+    size_t slabs;        /* slabs they took from the heap */
+    size_t capacity;     /* objects those slabs can hold */
+    size_t high_water;   /* sum of the pools' high-water marks */
+    size_t in_use;       /* objects still out at the end of the trace */
+} pool_sum_t;
+
+/*
+ * Directory of the live ids of a trace run with -W. It is allocated in
+ * the file-backed heap and recorded as the heap's root, so the next run
+ * finds the blocks the previous one left and carries on from next_op.
+ */
+#define PERSIST_MAGIC 0x6d64726976657221ULL
+typedef struct {
+    unsigned long long magic;
+    int num_ids;         /* shape of the trace that wrote it */
+    int num_ops;
+    int next_op;         /* first op the next run does */
+    struct {
+	size_t off;      /* 1 + offset of the payload from mem_heap_lo, or 0 */
+	size_t size;     /* payload size */
+    } id[];
+} persist_t;
+
+/*
+ * Log-bucketed (HDR-style) latency histogram. Values below
+ * 2^LAT_SUB_BITS have a bucket each; a larger value shares its bucket
+ * with the values that agree in its top LAT_SUB_BITS+1 bits, so a
+ * percentile read back from the buckets is off by less than 1/32.
+ */
+#define LAT_SUB_BITS 5
+#define LAT_BUCKETS  ((64 - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+
+typedef struct {
+    unsigned long long count[LAT_BUCKETS];
+    unsigned long long n;    /* ops recorded */
+    unsigned long long max;  /* largest latency in ns (exact) */
+} lat_hist_t;
+
 /* 
  * Holds the params to the xxx_speed functions, which are timed by fcyc. 
  * This struct is necessary because fcyc accepts only a pointer array
@@ -72,6 +148,10 @@ typedef struct {
 typedef struct {
     trace_t *trace;  
     range_t *ranges;
+    lat_hist_t *lat; /* if set, eval_mm_speed times every op into
+			lat[op type] (-L); NULL in the fcyc runs */
+    double *op_cycles; /* if set, eval_mm_speed adds the cycles of every
+			  op to op_cycles[op type] (-C) */
 } speed_t;
 
 /* Summarizes the important stats for some malloc function on some trace */
@@ -80,13 +160,43 @@ typedef struct {
     double ops;      /* number of ops (malloc/free/realloc) in the trace */
     int valid;       /* was the trace processed correctly by the allocator? */
     double secs;     /* number of secs needed to run the trace */
+    double hw[FPERF_EVENTS]; /* hardware events per run of the trace,
+				-1 if not counted (USE_PERF only) */
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
 
+    /* defined only with -C, from one extra pass with phase profiling */
+    int costs;               /* set if the two below were measured */
+    double op_cycles[3];     /* cycles in mm_malloc, mm_free, mm_realloc */
+    mm_phase_stats_t phase;  /* the allocator's phases in that pass */
+
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
+/* 
+ * The allocator under test: the mm package linked into mdriver, or one
+ * loaded from a shared object with -A. All calls from the trace
+ * routines go through the current one.
+ */
+typedef struct {
+    char *name;                             /* "mm.o" or the .so path */
+    team_t *team;
+    int (*init)(void);
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+} allocator_t;
+
+/* Summarizes the repeated timed runs of one trace (runner mode, -r) */
+typedef struct {
+    int n;           /* number of samples */
+    double ops;      /* number of ops in the trace */
+    double median;   /* median secs per run */
+    double mad;      /* median absolute deviation from it */
+    double lo, hi;   /* 95% confidence interval of the median */
+} sample_stats_t;
+
 /********************
  * Global variables
  *******************/
@@ -97,11 +207,51 @@ char msg[MAXLINE];      /* for whenever we need to compose an error message */
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
+/* If set, ids grouped by "g" annotations use the region API (-R) */
+static int use_regions = 0;
+
+/* If set, every id is a movable block from mm_halloc, and mm_compact
+   runs after every compact_every ops (-K) */
+static int compact_every = 0;
+static double compact_moved = 0; /* bytes moved in the validity passes */
+
+/* If set, requests of 1..pool_max bytes are served from one object
+   pool per size (-O) */
+static int pool_max = 0;
+
+/* Added to every fill byte, so that the -j workers sharing a heap
+   fill the same id differently */
+static int fill_salt = 0;
+
+/* mm_stats snapshots per trace from the util pass, taken at the peak
+   of live payload and at the end of the trace (-M) */
+static mm_stats_t *heap_peak = NULL, *heap_end = NULL;
+
+/* If set, the util pass writes mm_heap_profile at the peak of live
+   payload to mdriver-heap.<trace> (-H) */
+static int heap_profile = 0;
+
 /* The filenames of the default tracefiles */
 static char *default_tracefiles[] = {  
     DEFAULT_TRACEFILES, NULL
 };
 
+/* The mm package linked into mdriver; -A switches cur_mm per plugin */
+static allocator_t linked_mm = {
+    "mm.o", &team, mm_init, mm_malloc, mm_free, mm_realloc
+};
+static allocator_t *cur_mm = &linked_mm; /* allocator under test */
+
+/* Timer overhead subtracted from every latency sample, in ns (-L),
+   and from every op timed with the cycle counter (-C) */
+static unsigned long long lat_ovhd = 0;
+static unsigned long long cyc_ovhd = 0;
+
+/* Names accepted by -P, indexed by mm_fit_policy_t */
+static char *fit_policy_names[] = {
+    "first", "next", "best", "good", "adaptive", NULL
+};
+
 
 /********************* 
  * Function prototypes 
@@ -117,6 +267,18 @@ static void clear_ranges(range_t **ranges);
 static trace_t *read_trace(char *tracedir, char *filename);
 static void free_trace(trace_t *trace);
 
+/* Route requests through the region, handle or pool API (-R, -K, -O) */
+static void trace_begin(trace_t *trace);
+static char *trace_malloc(trace_t *trace, int index, int size);
+static char *trace_realloc(trace_t *trace, int index, char *oldp, int size);
+static void trace_free(trace_t *trace, int index, char *p);
+static size_t trace_compact(trace_t *trace);
+static int check_compact(trace_t *trace, int tracenum, int opnum,
+			 range_t **ranges);
+static char *pool_get(trace_t *trace, int size);
+static void pool_put(trace_t *trace, char *p, int size);
+static void pool_totals(trace_t *trace, pool_sum_t *sum);
+
 /* Routines for evaluating the correctness and speed of libc malloc */
 static int eval_libc_valid(trace_t *trace, int tracenum);
 static void eval_libc_speed(void *ptr);
@@ -124,11 +286,58 @@ static void eval_libc_speed(void *ptr);
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
+static int valid_op(trace_t *trace, int tracenum, int i, range_t **ranges);
+static int eval_persist(char *file, char *name, trace_t *trace, int stop,
+			int die);
+static int eval_shared(char *shm_name, char *name, trace_t *trace, 
+		       int tracenum, int n);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printcosts(int n, stats_t *stats);
+static void printcounters(int n, stats_t *stats);
+static void printlifetimes(int n, mm_lifetime_stats_t *life);
+static void printdeferred(int n, mm_deferred_stats_t *def);
+static void printpools(int n, pool_sum_t *sum);
+static void printfits(int n, mm_fit_stats_t *fit);
+static void printheap(int n, mm_stats_t *peak, mm_stats_t *end);
+static void printlatency(int n, lat_hist_t *lat);
+static void pin_cpu(int cpu);
+static void run_samples(speed_t *params, int warmups, int n, 
+			sample_stats_t *st);
+static int cmp_double(const void *a, const void *b);
+static void printsamples(int n, char **names, sample_stats_t *st);
+static void savesamples(char *file, int n, char **names, sample_stats_t *st);
+static void comparesamples(char *file, int n, char **names, 
+			   sample_stats_t *st);
+static int metrics(int i, stats_t *stats, sample_stats_t *st, 
+		   lat_hist_t *lat, int costs, char **name, double *val);
+static void json_string(FILE *fp, char *str);
+static void csv_string(FILE *fp, char *str);
+static void writeresults(FILE *fp, int format, int n, char **names, 
+			 stats_t *stats, sample_stats_t *st, lat_hist_t *lat,
+			 int costs, double *perf);
+static int json_field(char *line, char *key, char *val);
+static int csv_split(char *line, char **field, int max);
+static int comparebaseline(char *file, double thru_tol, double util_tol,
+			   int n, char **names, stats_t *stats, 
+			   sample_stats_t *st);
+static int load_plugins(char *list, allocator_t **out);
+static void eval_plugins(int na, allocator_t *a, int n, char **names,
+			 int samples, int warmups);
+static void printplugins(int na, allocator_t *a, int n, char **names,
+			 stats_t *stats, sample_stats_t *st, int *errs);
+static unsigned long long lat_now(void);
+static unsigned long long cyc_now(void);
+static unsigned long long timer_ovhd(unsigned long long (*now)(void));
+static int lat_bucket(unsigned long long v);
+static void lat_record(lat_hist_t *h, unsigned long long ns);
+static unsigned long long lat_percentile(lat_hist_t *h, double pct);
+static int peak_op(trace_t *trace);
+static void write_heap_profile(int tracenum);
+static unsigned long search_pct(mm_stats_t *st, double pct);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -140,7 +349,7 @@ static void app_error(char *msg);
 int main(int argc, char **argv)
 {
     int i;
-    char c;
+    int c;
     char **tracefiles = NULL;  /* null-terminated array of trace file names */
     int num_tracefiles = 0;    /* the number of traces in that array */
     trace_t *trace = NULL;     /* stores a single trace file in memory */
@@ -152,6 +361,49 @@ int main(int argc, char **argv)
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int policy;          /* placement policy index (set by -P) */
+    int nursery = 0;     /* If set, enable lifetime prediction (set by -N) */
+    mm_lifetime_stats_t *life_stats = NULL; /* prediction stats per trace */
+    int deferred = 0;    /* If set, defer frees to a background thread (-D) */
+    mm_deferred_stats_t *def_stats = NULL;  /* deferred free stats per trace */
+    int fitprof = 0;     /* If set, time the free list searches (-F) */
+    mm_fit_stats_t *fit_stats = NULL;       /* find_fit stats per trace */
+    pool_sum_t *pool_sums = NULL;           /* pool stats per trace (-O) */
+    int heapstats = 0;   /* If set, report mm_stats per trace (-M) */
+    int latency = 0;     /* If set, time each op of one speed pass (-L) */
+    int costs = 0;       /* If set, break one speed pass down by op and phase (-C) */
+    lat_hist_t *lat = NULL; /* latency per trace and op type */
+    char *shm_name = NULL; /* shared-memory segment for the heap (-S) */
+    int shm_workers = 0; /* with -S, processes that share the heap (-j) */
+    char *heap_file = NULL; /* file that keeps the heap across runs (-W) */
+    int persist_ops = 0; /* with -W, stop this run after this many ops (-E) */
+    int persist_die = 0; /* ... and kill the driver there (-k) */
+    int samples = 0;     /* If set, time this many runs per trace (-r) */
+    int warmups = 3;     /* untimed runs before those samples (-w) */
+    int cpu = -1;        /* CPU to pin to, or -1 to leave it to the OS (-p) */
+    char *save_file = NULL;    /* write the sample summary here (-s) */
+    char *compare_file = NULL; /* compare the samples with this one (-c) */
+    sample_stats_t *sample_stats = NULL; /* runner results per trace */
+    int format = FMT_TEXT;     /* results format (--format) */
+    FILE *results_fp = NULL;   /* where the json/csv results go */
+    char *baseline = NULL;     /* stored results to compare with (--baseline) */
+    double thru_tol = 10;      /* allowed throughput drop in % */
+    double util_tol = 1;       /* allowed utilization drop in points */
+    int regressions = 0;       /* traces worse than the baseline */
+    double perf[3];            /* perf index: util, thru, total */
+    char *plugin_list = NULL;  /* shared objects to compare (-A) */
+    allocator_t *plugins = NULL; /* ... and the allocators loaded from them */
+    int num_plugins = 0;
+    int linked_only = 0;       /* last option that needs the linked mm */
+    static struct option long_options[] = {
+	{"format", required_argument, NULL, OPT_FORMAT},
+	{"baseline", required_argument, NULL, OPT_BASELINE},
+	{"thru-threshold", required_argument, NULL, OPT_THRU_THRESHOLD},
+	{"util-threshold", required_argument, NULL, OPT_UTIL_THRESHOLD},
+	{"help", no_argument, NULL, 'h'},
+	{NULL, 0, NULL, 0}
+    };
+    int shm_created = 0;   /* set if this process created that segment */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -160,8 +412,46 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt_long(argc, argv, "c:f:j:p:r:s:t:w:A:E:H:K:O:P:S:W:hvVgaklCDFLMNRT",
+			    long_options, NULL)) != EOF) {
         switch (c) {
+	case OPT_FORMAT: /* Machine-readable results on stdout */
+	    if (!strcmp(optarg, "json"))
+		format = FMT_JSON;
+	    else if (!strcmp(optarg, "csv"))
+		format = FMT_CSV;
+	    else if (!strcmp(optarg, "text"))
+		format = FMT_TEXT;
+	    else {
+		fprintf(stderr, "Unknown format: %s\n", optarg);
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_BASELINE: /* Fail on a regression against stored results */
+	    baseline = strdup(optarg);
+	    break;
+	case OPT_THRU_THRESHOLD: /* Allowed throughput drop in % */
+	    thru_tol = atof(optarg);
+	    break;
+	case OPT_UTIL_THRESHOLD: /* Allowed utilization drop in points */
+	    util_tol = atof(optarg);
+	    break;
+	case 'A': /* Evaluate allocators loaded from shared objects */
+	    plugin_list = strdup(optarg);
+	    break;
+	case 'E': /* With -W, stop after <n> ops */
+	    if ((persist_ops = atoi(optarg)) < 1) {
+		fprintf(stderr, "Need at least one op per run\n");
+		exit(1);
+	    }
+	    break;
+	case 'k': /* With -W -E, kill the driver at the stop */
+	    persist_die = 1;
+	    break;
+	case 'c': /* Compare the runner samples with a saved run */
+	    compare_file = strdup(optarg);
+	    break;
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
 	    break;
@@ -180,12 +470,138 @@ int main(int argc, char **argv)
 	    if (tracedir[strlen(tracedir)-1] != '/') 
 		strcat(tracedir, "/"); /* path always ends with "/" */
 	    break;
+	case 'p': /* Pin to one CPU */
+	    cpu = atoi(optarg);
+	    break;
+	case 'r': /* Runner mode: time <n> runs per trace */
+	    if ((samples = atoi(optarg)) < 1) {
+		fprintf(stderr, "Need at least one sample per trace\n");
+		exit(1);
+	    }
+	    break;
+	case 's': /* Save the runner samples for a later -c */
+	    save_file = strdup(optarg);
+	    break;
+	case 'w': /* Warm-up runs before the samples */
+	    warmups = atoi(optarg);
+	    break;
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+	case 'O': /* Object pools for requests up to <bytes> */
+	    linked_only = c;
+	    if ((pool_max = atoi(optarg)) < 1) {
+		fprintf(stderr, "Pools need a size of at least one byte\n");
+		exit(1);
+	    }
+	    break;
+	case 'P': /* Placement policy for mm.c */
+	    linked_only = c;
+	    for (policy = 0; fit_policy_names[policy] != NULL; policy++)
+		if (!strcmp(optarg, fit_policy_names[policy]))
+		    break;
+	    if (fit_policy_names[policy] == NULL) {
+		fprintf(stderr, "Unknown placement policy: %s\n", optarg);
+		usage();
+		exit(1);
+	    }
+	    if (mm_set_fit_policy((mm_fit_policy_t)policy) < 0) {
+		fprintf(stderr, "Placement policy %s is not supported by this "
+			"allocator\n", optarg);
+		exit(1);
+	    }
+	    break;
+	case 'C': /* Cost per op type and per allocator phase */
+	    linked_only = c;
+	    if (mm_set_phase_profile(1) < 0) {
+		fprintf(stderr, "Phase profiling is not supported by this "
+			"allocator\n");
+		exit(1);
+	    }
+	    mm_set_phase_profile(0); /* only for the extra pass */
+	    costs = 1;
+	    break;
+	case 'D': /* Deferred free with background coalescing in mm.c */
+	    linked_only = c;
+	    if (mm_set_deferred_free(1) < 0) {
+		fprintf(stderr, "Deferred free is not supported by this "
+			"allocator (build with -DMM_THREADS)\n");
+		exit(1);
+	    }
+	    deferred = 1;
+	    break;
+	case 'F': /* Time the free list searches in mm.c */
+	    linked_only = c;
+	    if (mm_set_fit_profile(1) < 0) {
+		fprintf(stderr, "Fit profiling is not supported by this "
+			"allocator\n");
+		exit(1);
+	    }
+	    fitprof = 1;
+	    break;
+	case 'H': /* Sample the heap every <bytes> and write profiles */
+	    linked_only = c;
+	    if (atol(optarg) <= 0 || mm_set_heap_sampling(atol(optarg)) < 0) {
+		fprintf(stderr, "Heap sampling every %s bytes is not supported "
+			"by this allocator\n", optarg);
+		exit(1);
+	    }
+	    heap_profile = 1;
+	    break;
+	case 'K': /* Movable blocks, compacted every <n> ops */
+	    linked_only = c;
+	    if ((compact_every = atoi(optarg)) < 1) {
+		fprintf(stderr, "Need at least one op between compactions\n");
+		exit(1);
+	    }
+	    break;
+	case 'L': /* Per-op latency percentiles */
+	    linked_only = c;
+	    latency = 1;
+	    break;
+	case 'M': /* Report mm_stats heap snapshots and counters */
+	    linked_only = c;
+	    heapstats = 1;
+	    break;
+	case 'N': /* Lifetime prediction and nursery in mm.c */
+	    linked_only = c;
+	    if (mm_set_nursery(1) < 0) {
+		fprintf(stderr, "Lifetime prediction is not supported by this "
+			"allocator\n");
+		exit(1);
+	    }
+	    nursery = 1;
+	    break;
+	case 'R': /* Use the region API for ids grouped by "g" lines */
+	    linked_only = c;
+	    use_regions = 1;
+	    break;
+	case 'S': /* Simulated heap in a named shared-memory segment */
+	    shm_name = strdup(optarg);
+	    break;
+	case 'j': /* With -S, run each trace in <n> processes at once */
+	    linked_only = c;
+	    shm_workers = atoi(optarg);
+	    if (shm_workers < 1 || shm_workers > 255) {
+		fprintf(stderr, "-j needs 1 to 255 workers\n");
+		exit(1);
+	    }
+	    break;
+	case 'W': /* Heap in a file that survives the run */
+	    linked_only = c;
+	    heap_file = strdup(optarg);
+	    break;
+	case 'T': /* Two-ended placement in mm.c */
+	    linked_only = c;
+	    if (mm_set_place_policy(MM_PLACE_TWO_ENDED) < 0) {
+		fprintf(stderr, "Two-ended placement is not supported by this "
+			"allocator\n");
+		exit(1);
+	    }
+	    break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -200,6 +616,62 @@ int main(int argc, char **argv)
             exit(1);
         }
     }
+
+    /* -A only gets the four calls and the team from each plugin */
+    if (plugin_list != NULL) {
+	if (linked_only) {
+	    fprintf(stderr, "-%c needs the linked allocator; it can't be "
+		    "combined with -A\n", linked_only);
+	    exit(1);
+	}
+	if (format != FMT_TEXT || baseline || save_file || compare_file) {
+	    fprintf(stderr, "--format, --baseline, -s and -c can't be "
+		    "combined with -A\n");
+	    exit(1);
+	}
+	num_plugins = load_plugins(plugin_list, &plugins);
+    }
+
+    /* -W only runs plain malloc/realloc/free on its own heap */
+    if (heap_file != NULL && 
+	(shm_name || compact_every || pool_max || use_regions)) {
+	fprintf(stderr, "-W can't be combined with -K, -O, -R or -S\n");
+	exit(1);
+    }
+    if ((persist_ops || persist_die) && heap_file == NULL) {
+	fprintf(stderr, "-E and -k need a heap file (-W <file>)\n");
+	exit(1);
+    }
+    if (persist_die && !persist_ops) {
+	fprintf(stderr, "-k needs a stop point (-E <n>)\n");
+	exit(1);
+    }
+
+    /* -j workers run plain malloc/realloc/free on the -S heap */
+    if (shm_workers && shm_name == NULL) {
+	fprintf(stderr, "-j needs a shared-memory segment (-S <shm>)\n");
+	exit(1);
+    }
+    if (shm_workers && (compact_every || pool_max || use_regions)) {
+	fprintf(stderr, "-j can't be combined with -K, -O or -R\n");
+	exit(1);
+    }
+
+    /* An id is in a region, behind a handle or in a pool, not two */
+    if ((compact_every != 0) + (pool_max != 0) + use_regions > 1) {
+	fprintf(stderr, "-K, -O and -R can't be combined\n");
+	exit(1);
+    }
+
+    /* With --format, stdout carries only the results; the usual
+       report goes to stderr */
+    if (format != FMT_TEXT) {
+	fflush(stdout);
+	if ((c = dup(STDOUT_FILENO)) < 0 || 
+	    (results_fp = fdopen(c, "w")) == NULL)
+	    unix_error("Could not set up the results stream");
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
 	
     /* 
      * Check and print team info 
@@ -237,6 +709,13 @@ int main(int argc, char **argv)
 	printf("Using default tracefiles in %s\n", tracedir);
     }
 
+    if ((save_file != NULL || compare_file != NULL) && !samples) {
+	fprintf(stderr, "-s and -c need runner samples (-r <n>)\n");
+	exit(1);
+    }
+    if (cpu >= 0)
+	pin_cpu(cpu);
+
     /* Initialize the timing package */
     init_fsecs();
 
@@ -261,9 +740,14 @@ int main(int argc, char **argv)
 	    libc_stats[i].valid = eval_libc_valid(trace, i);
 	    if (libc_stats[i].valid) {
 		speed_params.trace = trace;
+		speed_params.lat = NULL;
+		speed_params.op_cycles = NULL;
 		if (verbose > 1)
 		    printf("and performance.\n");
 		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+#if USE_PERF
+		fperf_last(libc_stats[i].hw);
+#endif
 	    }
 	    free_trace(trace);
 	}
@@ -285,9 +769,105 @@ int main(int argc, char **argv)
     mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
     if (mm_stats == NULL)
 	unix_error("mm_stats calloc in main failed");
+    life_stats = (mm_lifetime_stats_t *)calloc(num_tracefiles, 
+					       sizeof(mm_lifetime_stats_t));
+    if (life_stats == NULL)
+	unix_error("life_stats calloc in main failed");
+    def_stats = (mm_deferred_stats_t *)calloc(num_tracefiles, 
+					      sizeof(mm_deferred_stats_t));
+    if (def_stats == NULL)
+	unix_error("def_stats calloc in main failed");
+    fit_stats = (mm_fit_stats_t *)calloc(num_tracefiles, 
+					 sizeof(mm_fit_stats_t));
+    if (fit_stats == NULL)
+	unix_error("fit_stats calloc in main failed");
+    if (pool_max) {
+	pool_sums = (pool_sum_t *)calloc(num_tracefiles, sizeof(pool_sum_t));
+	if (pool_sums == NULL)
+	    unix_error("pool_sums calloc in main failed");
+    }
+    if (latency) {
+	lat = (lat_hist_t *)calloc(3 * num_tracefiles, sizeof(lat_hist_t));
+	if (lat == NULL)
+	    unix_error("lat calloc in main failed");
+	lat_ovhd = timer_ovhd(lat_now);
+    }
+    if (costs)
+	cyc_ovhd = timer_ovhd(cyc_now);
+    if (samples) {
+	sample_stats = (sample_stats_t *)calloc(num_tracefiles, 
+						sizeof(sample_stats_t));
+	if (sample_stats == NULL)
+	    unix_error("sample_stats calloc in main failed");
+    }
+    if (heapstats) {
+	heap_peak = (mm_stats_t *)calloc(num_tracefiles, sizeof(mm_stats_t));
+	heap_end = (mm_stats_t *)calloc(num_tracefiles, sizeof(mm_stats_t));
+	if (heap_peak == NULL || heap_end == NULL)
+	    unix_error("heap stats calloc in main failed");
+    }
     
+    /* With -W, run the first trace on the heap in the file and stop */
+    if (heap_file != NULL) {
+	trace = read_trace(tracedir, tracefiles[0]);
+	exit(eval_persist(heap_file, tracefiles[0], trace, persist_ops,
+			  persist_die));
+    }
+
     /* Initialize the simulated memory system in memlib.c */
-    mem_init(); 
+    if (shm_name == NULL)
+	mem_init(); 
+    else if ((shm_created = mem_init_shared(shm_name)) < 0) {
+	sprintf(msg, "Could not map shared-memory segment %s", shm_name);
+	unix_error(msg);
+    }
+    else if (!shm_created) { /* resetting it would wipe a live heap */
+	fprintf(stderr, "Shared-memory segment %s already exists and may "
+		"be in use; remove it (/dev/shm%s) if it is not\n", 
+		shm_name, shm_name);
+	exit(1);
+    }
+
+    /* With -j, check each trace in that many processes at once */
+    if (shm_workers) {
+	if (mm_set_root(NULL) < 0) {
+	    fprintf(stderr, "Heaps shared between processes are not "
+		    "supported by this allocator (build mm.c with "
+		    "-DMM_SHARED)\n");
+	    mem_unlink_shared(shm_name);
+	    exit(1);
+	}
+	for (i = 0; i < num_tracefiles; i++) {
+	    trace = read_trace(tracedir, tracefiles[i]);
+	    if (eval_shared(shm_name, tracefiles[i], trace, i, shm_workers) <
+		shm_workers)
+		errors++;
+	    free_trace(trace);
+	}
+	mem_unlink_shared(shm_name);
+	exit(errors ? 1 : 0);
+    }
+
+    /* -K needs handles; engines without them fail every mm_halloc */
+    if (compact_every) {
+	mem_reset_brk();
+	if (mm_init() < 0 || mm_halloc(1) == 0) {
+	    fprintf(stderr, "Movable blocks are not supported by this "
+		    "allocator\n");
+	    if (shm_created)
+		mem_unlink_shared(shm_name);
+	    exit(1);
+	}
+    }
+
+    /* With -A, rank the plugins on the same traces instead */
+    if (num_plugins) {
+	eval_plugins(num_plugins, plugins, num_tracefiles, tracefiles, 
+		     samples, warmups);
+	if (shm_created)
+	    mem_unlink_shared(shm_name);
+	exit(0);
+    }
 
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i=0; i < num_tracefiles; i++) {
@@ -300,11 +880,37 @@ int main(int argc, char **argv)
 	    if (verbose > 1)
 		printf("efficiency, ");
 	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    mm_lifetime_stats(&life_stats[i]); /* from the util pass */
+	    mm_deferred_stats(&def_stats[i]);
+	    mm_fit_stats(&fit_stats[i]);
+	    if (pool_max)
+		pool_totals(trace, &pool_sums[i]);
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
 	    if (verbose > 1)
 		printf("and performance.\n");
+	    speed_params.lat = NULL;
+	    speed_params.op_cycles = NULL;
 	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+#if USE_PERF
+	    fperf_last(mm_stats[i].hw);
+#endif
+	    if (samples) /* warm up, then time each run on its own */
+		run_samples(&speed_params, warmups, samples, &sample_stats[i]);
+	    if (latency) { /* one more pass, timed op by op */
+		speed_params.lat = &lat[3 * i];
+		eval_mm_speed(&speed_params);
+		speed_params.lat = NULL;
+	    }
+	    if (costs) { /* one more pass, with the allocator's phases timed */
+		mm_set_phase_profile(1);
+		speed_params.op_cycles = mm_stats[i].op_cycles;
+		eval_mm_speed(&speed_params);
+		speed_params.op_cycles = NULL;
+		mm_phase_stats(&mm_stats[i].phase);
+		mm_set_phase_profile(0);
+		mm_stats[i].costs = 1;
+	    }
 	}
 	free_trace(trace);
     }
@@ -316,6 +922,77 @@ int main(int argc, char **argv)
 	printf("\n");
     }
 
+    /* Display how well the lifetime predictor did on each trace */
+    if (nursery) {
+	printf("Lifetime prediction for mm malloc:\n");
+	printlifetimes(num_tracefiles, life_stats);
+	printf("\n");
+    }
+
+    /* Display how much the compactions in the validity passes moved */
+    if (compact_every) {
+	printf("Compaction every %d ops moved %.0f KB in the validity "
+	       "passes\n\n", compact_every, compact_moved / 1024);
+    }
+
+    /* Display how full the object pools got */
+    if (pool_max) {
+	printf("Object pools for requests up to %d bytes:\n", pool_max);
+	printpools(num_tracefiles, pool_sums);
+	printf("\n");
+    }
+
+    /* Display how far frees lagged behind reuse with deferred free */
+    if (deferred) {
+	printf("Deferred free for mm malloc:\n");
+	printdeferred(num_tracefiles, def_stats);
+	printf("\n");
+    }
+
+    /* Display what one step of the free list traversal costs */
+    if (fitprof) {
+	printf("Free list search for mm malloc:\n");
+	printfits(num_tracefiles, fit_stats);
+	printf("\n");
+    }
+
+    /* Display the runner's repeated samples and compare them */
+    if (samples) {
+	printf("Runner samples for mm malloc (%d per trace after %d warm-up "
+	       "runs", samples, warmups);
+	if (cpu >= 0)
+	    printf(", pinned to CPU %d", cpu);
+	printf("):\n");
+	printsamples(num_tracefiles, tracefiles, sample_stats);
+	printf("\n");
+	if (compare_file != NULL) {
+	    comparesamples(compare_file, num_tracefiles, tracefiles, 
+			   sample_stats);
+	    printf("\n");
+	}
+	if (save_file != NULL)
+	    savesamples(save_file, num_tracefiles, tracefiles, sample_stats);
+    }
+
+    /* Display the latency percentiles of each op type */
+    if (latency) {
+	printf("Operation latency for mm malloc (ns, less %llu ns timer "
+	       "overhead):\n", lat_ovhd);
+	printlatency(num_tracefiles, lat);
+	printf("\n");
+    }
+
+    /* Display the heap at its peak and the allocator's counters */
+    if (heapstats) {
+	printheap(num_tracefiles, heap_peak, heap_end);
+	printf("\n");
+    }
+
+    /* Point at the heap profiles written by the util pass */
+    if (heap_profile)
+	printf("Heap profiles at peak payload: mdriver-heap.0 .. mdriver-heap.%d "
+	       "(pprof <program> <file>)\n\n", num_tracefiles - 1);
+
     /* 
      * Accumulate the aggregate statistics for the student's mm package 
      */
@@ -352,7 +1029,9 @@ int main(int argc, char **argv)
 	       p1*100, 
 	       p2*100, 
 	       perfindex);
-	
+	perf[0] = p1*100;
+	perf[1] = p2*100;
+	perf[2] = perfindex;
     }
     else { /* There were errors */
 	perfindex = 0.0;
@@ -364,7 +1043,120 @@ int main(int argc, char **argv)
 	printf("perfidx:%.0f\n", perfindex);
     }
 
-    exit(0);
+    /* Machine-readable results and the regression check */
+    if (results_fp != NULL) {
+	writeresults(results_fp, format, num_tracefiles, tracefiles, mm_stats,
+		     sample_stats, lat, costs, errors ? NULL : perf);
+	fclose(results_fp);
+    }
+    if (baseline != NULL) {
+	printf("\n");
+	regressions = comparebaseline(baseline, thru_tol, util_tol, 
+				      num_tracefiles, tracefiles, mm_stats,
+				      sample_stats);
+    }
+
+    if (shm_created)
+	mem_unlink_shared(shm_name);
+
+    exit(regressions ? 2 : 0);
+}
+
+/*
+ * trace_compact - Unlock every live id, let mm_compact finish a pass
+ *     over the heap, and lock the ids again at their new addresses
+ *     (-K). Returns the number of bytes moved.
+ */
+static size_t trace_compact(trace_t *trace)
+{
+    int i;
+    size_t moved;
+
+    for (i = 0; i < trace->num_ids; i++)
+	if (trace->handles[i])
+	    mm_hunlock(trace->handles[i]);
+    moved = mm_compact(0);
+    for (i = 0; i < trace->num_ids; i++)
+	if (trace->handles[i])
+	    trace->blocks[i] = mm_hlock(trace->handles[i]);
+    return moved;
+}
+
+/*
+ * check_compact - Compact after op opnum and check the result: the
+ *     live blocks are rebuilt into the range list (aligned, inside the
+ *     heap, no overlap) and must still hold the byte they were filled
+ *     with.
+ */
+static int check_compact(trace_t *trace, int tracenum, int opnum,
+			 range_t **ranges)
+{
+    int i;
+    size_t j;
+
+    clear_ranges(ranges);
+    compact_moved += trace_compact(trace);
+    for (i = 0; i < trace->num_ids; i++) {
+	if (trace->handles[i] == 0)
+	    continue;
+	if (add_range(ranges, trace->blocks[i], trace->block_sizes[i],
+		      tracenum, opnum) == 0)
+	    return 0;
+	for (j = 0; j < trace->block_sizes[i]; j++) {
+	    if (trace->blocks[i][j] != FILL(i)) {
+		malloc_error(tracenum, opnum, "mm_compact did not preserve "
+			     "the data of a moved block");
+		return 0;
+	    }
+	}
+    }
+    return 1;
+}
+
+/*
+ * pool_get - An object from the pool for size, created on first use,
+ *     or mm_malloc if size is 0 or above pool_max (-O)
+ */
+static char *pool_get(trace_t *trace, int size)
+{
+    if (size == 0 || size > pool_max)
+	return cur_mm->malloc(size);
+    if (trace->pools[size] == NULL &&
+	(trace->pools[size] = mm_pool_create(size, 0)) == NULL)
+	return NULL;
+    return mm_pool_get(trace->pools[size]);
+}
+
+/*
+ * pool_put - Give back a block that pool_get returned for size
+ */
+static void pool_put(trace_t *trace, char *p, int size)
+{
+    if (size == 0 || size > pool_max)
+	cur_mm->free(p);
+    else
+	mm_pool_put(trace->pools[size], p);
+}
+
+/*
+ * pool_totals - Add up the stats of every pool the last run created
+ */
+static void pool_totals(trace_t *trace, pool_sum_t *sum)
+{
+    mm_pool_stats_t st;
+    int i;
+
+    memset(sum, 0, sizeof(*sum));
+    for (i = 1; i <= pool_max; i++) {
+	if (trace->pools[i] == NULL)
+	    continue;
+	mm_pool_stats(trace->pools[i], &st);
+	sum->pools++;
+	sum->slabs += st.slabs;
+	sum->capacity += st.capacity;
+	sum->high_water += st.high_water;
+	sum->in_use += st.in_use;
+    }
 }
 
 
@@ -482,6 +1274,8 @@ static trace_t *read_trace(char *tracedir, char *filename)
     unsigned index, size;
     unsigned max_index = 0;
     unsigned op_index;
+    unsigned region;
+    int i;
 
     if (verbose > 1)
 	printf("Reading tracefile: %s\n", filename);
@@ -516,6 +1310,14 @@ static trace_t *read_trace(char *tracedir, char *filename)
     if ((trace->block_sizes = 
 	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
 	unix_error("malloc 4 failed in read_trace");
+
+    /* ... and the region, if any, that each id belongs to */
+    if ((trace->region_of = 
+	 (int *)malloc(trace->num_ids * sizeof(int))) == NULL)
+	unix_error("malloc 5 failed in read_trace");
+    for (i = 0; i < trace->num_ids; i++)
+	trace->region_of[i] = -1;
+    trace->num_regions = 0;
     
     /* read every request line in the trace file */
     index = 0;
@@ -541,6 +1343,17 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    trace->ops[op_index].type = FREE;
 	    trace->ops[op_index].index = index;
 	    break;
+	case 'g': /* annotation, not a request: id belongs to region */
+	    fscanf(tracefile, "%u %u", &region, &index);
+	    if (index >= (unsigned)trace->num_ids) {
+		printf("Bad region annotation (g %u %u) in tracefile %s\n",
+		       region, index, path);
+		exit(1);
+	    }
+	    trace->region_of[index] = region;
+	    if ((int)region >= trace->num_regions)
+		trace->num_regions = region + 1;
+	    continue;
 	default:
 	    printf("Bogus type character (%c) in tracefile %s\n", 
 		   type[0], path);
@@ -552,22 +1365,172 @@ static trace_t *read_trace(char *tracedir, char *filename)
     fclose(tracefile);
     assert(max_index == trace->num_ids - 1);
     assert(trace->num_ops == op_index);
+
+    /* Regions are created lazily while the trace runs */
+    if ((trace->regions = (mm_region_t **)
+	 calloc(trace->num_regions + 1, sizeof(mm_region_t *))) == NULL)
+	unix_error("malloc 6 failed in read_trace");
+    if ((trace->region_live = 
+	 (int *)calloc(trace->num_regions + 1, sizeof(int))) == NULL)
+	unix_error("malloc 7 failed in read_trace");
+    if ((trace->spare_regions = (mm_region_t **)
+	 malloc((trace->num_regions + 1) * sizeof(mm_region_t *))) == NULL)
+	unix_error("malloc 8 failed in read_trace");
+
+    /* Handles are only used with -K */
+    if ((trace->handles = (mm_handle_t *)
+	 calloc(trace->num_ids, sizeof(mm_handle_t))) == NULL)
+	unix_error("malloc 9 failed in read_trace");
+
+    /* ... and pools only with -O */
+    if ((trace->pools = (mm_pool_t **)
+	 calloc(pool_max + 1, sizeof(mm_pool_t *))) == NULL)
+	unix_error("malloc 10 failed in read_trace");
     
     return trace;
 }
 
 /*
- * free_trace - Free the trace record and the three arrays it points
+ * free_trace - Free the trace record and the arrays it points
  *              to, all of which were allocated in read_trace().
  */
 void free_trace(trace_t *trace)
 {
-    free(trace->ops);         /* free the three arrays... */
+    free(trace->ops);         /* free the arrays... */
     free(trace->blocks);      
     free(trace->block_sizes);
+    free(trace->region_of);
+    free(trace->regions);
+    free(trace->region_live);
+    free(trace->spare_regions);
+    free(trace->handles);
+    free(trace->pools);
     free(trace);              /* and the trace record itself... */
 }
 
+/*
+ * trace_begin - Forget the regions, handles and pools of the previous
+ *     run. Must be called right after mm_init, since they all lived in
+ *     the heap that mm_init just discarded.
+ */
+static void trace_begin(trace_t *trace)
+{
+    memset(trace->regions, 0, trace->num_regions * sizeof(mm_region_t *));
+    memset(trace->region_live, 0, trace->num_regions * sizeof(int));
+    trace->num_spare = 0;
+    memset(trace->handles, 0, trace->num_ids * sizeof(mm_handle_t));
+    memset(trace->pools, 0, (pool_max + 1) * sizeof(mm_pool_t *));
+}
+
+/*
+ * trace_malloc - mm_malloc, or mm_region_alloc if -R is set and the id
+ *     belongs to a region. On first use a region takes a spare (reset)
+ *     region if there is one, the way a server reuses the arena of a
+ *     finished request, and creates a new one otherwise. With -K the
+ *     id gets a handle instead and stays locked until it is freed or
+ *     the next compaction; with -O a small id comes from a pool.
+ */
+static char *trace_malloc(trace_t *trace, int index, int size)
+{
+    int r = trace->region_of[index];
+
+    if (compact_every) {
+	if ((trace->handles[index] = mm_halloc(size)) == 0)
+	    return NULL;
+	trace->block_sizes[index] = size;
+	return mm_hlock(trace->handles[index]);
+    }
+    if (pool_max) {
+	trace->block_sizes[index] = size;
+	return pool_get(trace, size);
+    }
+    if (!use_regions || r < 0)
+	return cur_mm->malloc(size);
+    if (trace->regions[r] == NULL) {
+	if (trace->num_spare > 0)
+	    trace->regions[r] = trace->spare_regions[--trace->num_spare];
+	else if ((trace->regions[r] = mm_region_create()) == NULL)
+	    return NULL;
+    }
+    trace->region_live[r]++;
+    trace->block_sizes[index] = size;
+    return mm_region_alloc(trace->regions[r], size);
+}
+
+/*
+ * trace_realloc - mm_realloc, or for a region id a fresh region
+ *     allocation plus a copy. The old space is reclaimed at the next
+ *     reset of the region. With -K a new handle plus a copy; the old
+ *     handle is freed. With -O a copy too, unless neither size is
+ *     served from a pool.
+ */
+static char *trace_realloc(trace_t *trace, int index, char *oldp, int size)
+{
+    int r = trace->region_of[index];
+    size_t oldsize = trace->block_sizes[index];
+    mm_handle_t h;
+    char *newp;
+
+    if (compact_every) {
+	if ((h = mm_halloc(size)) == 0)
+	    return NULL;
+	newp = mm_hlock(h);
+	memcpy(newp, oldp, (oldsize < (size_t)size) ? oldsize : (size_t)size);
+	mm_hunlock(trace->handles[index]);
+	mm_hfree(trace->handles[index]);
+	trace->handles[index] = h;
+	trace->block_sizes[index] = size;
+	return newp;
+    }
+    if (pool_max && (oldsize <= (size_t)pool_max || size <= pool_max)) {
+	if ((newp = pool_get(trace, size)) == NULL)
+	    return NULL;
+	memcpy(newp, oldp, (oldsize < (size_t)size) ? oldsize : (size_t)size);
+	pool_put(trace, oldp, oldsize);
+	trace->block_sizes[index] = size;
+	return newp;
+    }
+    if (pool_max)
+	trace->block_sizes[index] = size;
+    if (!use_regions || r < 0)
+	return cur_mm->realloc(oldp, size);
+    if ((newp = mm_region_alloc(trace->regions[r], size)) == NULL)
+	return NULL;
+    memcpy(newp, oldp, (oldsize < (size_t)size) ? oldsize : (size_t)size);
+    trace->block_sizes[index] = size;
+    return newp;
+}
+
+/*
+ * trace_free - mm_free, or for a region id drop it from the live
+ *     count. Once its last id is freed the whole region is reset and
+ *     put on the spare list.
+ */
+static void trace_free(trace_t *trace, int index, char *p)
+{
+    int r = trace->region_of[index];
+
+    if (compact_every) {
+	mm_hunlock(trace->handles[index]);
+	mm_hfree(trace->handles[index]);
+	trace->handles[index] = 0;
+	return;
+    }
+    if (pool_max) {
+	pool_put(trace, p, trace->block_sizes[index]);
+	return;
+    }
+    if (!use_regions || r < 0) {
+	cur_mm->free(p);
+	return;
+    }
+    if (--trace->region_live[r] == 0) {
+	mm_region_reset(trace->regions[r]);
+	trace->spare_regions[trace->num_spare++] = trace->regions[r];
+	trace->regions[r] = NULL;
+    }
+}
+
 /**********************************************************************
  * The following functions evaluate the correctness, space utilization,
  * and throughput of the libc and mm malloc packages.
@@ -578,35 +1541,54 @@ void free_trace(trace_t *trace)
  */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
 {
-    int i, j;
-    int index;
-    int size;
-    int oldsize;
-    char *newp;
-    char *oldp;
-    char *p;
+    int i;
     
     /* Reset the heap and free any records in the range list */
     mem_reset_brk();
     clear_ranges(ranges);
 
     /* Call the mm package's init function */
-    if (mm_init() < 0) {
+    if (cur_mm->init() < 0) {
 	malloc_error(tracenum, 0, "mm_init failed.");
 	return 0;
     }
+    trace_begin(trace);
 
     /* Interpret each operation in the trace in order */
     for (i = 0;  i < trace->num_ops;  i++) {
-	index = trace->ops[i].index;
-	size = trace->ops[i].size;
+	if (valid_op(trace, tracenum, i, ranges) == 0)
+	    return 0;
+
+	/* With -K, move the blocks and check them again */
+	if (compact_every && (i + 1) % compact_every == 0 &&
+	    check_compact(trace, tracenum, i, ranges) == 0)
+	    return 0;
+    }
+
+    /* As far as we know, this is a valid malloc package */
+    return 1;
+}
+
+/*
+ * valid_op - Run op i of the trace and check the block it returns.
+ *     Returns 0 after reporting the first error, 1 otherwise.
+ */
+static int valid_op(trace_t *trace, int tracenum, int i, range_t **ranges)
+{
+    int j;
+    int index = trace->ops[i].index;
+    int size = trace->ops[i].size;
+    int oldsize;
+    char *newp;
+    char *oldp;
+    char *p;
 
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if ((p = trace_malloc(trace, index, size)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -624,7 +1606,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     * if we realloc the block and wish to make sure that the old
 	     * data was copied to the new block
 	     */
-	    memset(p, index & 0xFF, size);
+	    memset(p, FILL(index), size);
 
 	    /* Remember region */
 	    trace->blocks[index] = p;
@@ -635,7 +1617,8 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+	    oldsize = trace->block_sizes[index];
+	    if ((newp = trace_realloc(trace, index, oldp, size)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
 		return 0;
 	    }
@@ -652,16 +1635,15 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     * block and then fill in the new block with the low order byte
 	     * of the new index
 	     */
-	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if (newp[j] != FILL(index)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
 	      }
 	    }
-	    memset(newp, index & 0xFF, size);
+	    memset(newp, FILL(index), size);
 
 	    /* Remember region */
 	    trace->blocks[index] = newp;
@@ -670,31 +1652,228 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 
         case FREE: /* mm_free */
 	    
-	    /* Remove region from list and call student's free function */
+	    /* Make sure nothing else wrote to the block, then remove
+	       region from list and call student's free function */
 	    p = trace->blocks[index];
+	    for (j = 0; j < trace->block_sizes[index]; j++) {
+		if (p[j] != FILL(index)) {
+		    malloc_error(tracenum, i, "block was overwritten before "
+				 "mm_free");
+		    return 0;
+		}
+	    }
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    trace_free(trace, index, p);
 	    break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
-
-    }
-
-    /* As far as we know, this is a valid malloc package */
     return 1;
 }
 
-/* 
+/*
+ * eval_persist - Run the trace on a heap kept in a file (-W), going on
+ *     from where the previous run stopped. A reopened heap is not reset:
+ *     mm_init reattaches to it (recovering it if the previous run did
+ *     not shut down), and every block the previous run left live must
+ *     still be in the heap with its fill byte. The run stops after
+ *     stop ops (0 = the rest of the trace) with mm_shutdown, or, if die
+ *     is set, kills itself there so the next run has to recover. A
+ *     block leaves the directory before it goes to mm_free or
+ *     mm_realloc, so a run killed at any point leaks at most that one
+ *     block and never leaves a stale entry behind.
+ *     Returns the exit status for main.
+ */
+static int eval_persist(char *file, char *name, trace_t *trace, int stop,
+			int die)
+{
+    range_t *ranges = NULL;
+    persist_t *dir;
+    size_t dirsize = sizeof(persist_t) + trace->num_ids * sizeof(dir->id[0]);
+    char *lo;
+    int created, i, index, type, first, last, live = 0;
+    size_t j, live_bytes = 0;
+
+    if ((created = mem_init_file(file)) < 0) {
+	fprintf(stderr, "Could not map heap file %s\n", file);
+	return 1;
+    }
+    if (cur_mm->init() < 0) {
+	printf("ERROR: mm_init could not reattach to the heap in %s\n", file);
+	return 1;
+    }
+    lo = mem_heap_lo();
+    printf("Heap file %s: %s", file, created ? "created" : "reopened");
+    if (!created)
+	printf(", %s", mm_was_recovered() ? "recovered after a crash" : 
+	       "shut down cleanly");
+    printf("\n");
+
+    /* Check what the previous run left, or start a new directory */
+    trace_begin(trace);
+    if ((dir = mm_root()) != NULL) {
+	if (dir->magic != PERSIST_MAGIC || dir->num_ids != trace->num_ids ||
+	    dir->num_ops != trace->num_ops) {
+	    printf("ERROR: the heap in %s was left by another trace\n", file);
+	    return 1;
+	}
+	if (add_range(&ranges, (char *)dir, dirsize, 0, dir->next_op) == 0)
+	    return 1;
+	for (i = 0; i < trace->num_ids; i++) {
+	    if (dir->id[i].off == 0)
+		continue;
+	    trace->blocks[i] = lo + dir->id[i].off - 1;
+	    trace->block_sizes[i] = dir->id[i].size;
+	    if (add_range(&ranges, trace->blocks[i], dir->id[i].size, 0,
+			  dir->next_op) == 0)
+		return 1;
+	    for (j = 0; j < dir->id[i].size; j++) {
+		if (trace->blocks[i][j] != FILL(i)) {
+		    malloc_error(0, dir->next_op, "a block did not survive "
+				 "the restart");
+		    return 1;
+		}
+	    }
+	    live++;
+	    live_bytes += dir->id[i].size;
+	}
+	printf("Checked %d live blocks (%lu bytes) left by the previous run\n",
+	       live, (unsigned long)live_bytes);
+    }
+    else {
+	if ((dir = cur_mm->malloc(dirsize)) == NULL) {
+	    printf("ERROR: mm_malloc failed for the -W directory\n");
+	    return 1;
+	}
+	memset(dir, 0, dirsize);
+	dir->magic = PERSIST_MAGIC;
+	dir->num_ids = trace->num_ids;
+	dir->num_ops = trace->num_ops;
+	if (mm_set_root(dir) < 0) { /* only once dir is complete */
+	    fprintf(stderr, "Persistent heaps are not supported by this "
+		    "allocator (build mm.c with -DMM_SHARED)\n");
+	    return 1;
+	}
+	if (add_range(&ranges, (char *)dir, dirsize, 0, 0) == 0)
+	    return 1;
+    }
+
+    /* Go on with the trace, keeping the directory up to date */
+    first = dir->next_op;
+    last = (stop && first + stop < trace->num_ops) ? first + stop : 
+	trace->num_ops;
+    for (i = first; i < last; i++) {
+	index = trace->ops[i].index;
+	type = trace->ops[i].type;
+	if (type != ALLOC && dir->id[index].off == 0) {
+	    /* 
+	     * The previous run was killed in this op after dropping the
+	     * block: the free may have happened, so count it as done, and
+	     * start the realloc over as a malloc.
+	     */
+	    if (type == FREE) {
+		dir->next_op = i + 1;
+		continue;
+	    }
+	    trace->ops[i].type = ALLOC;
+	}
+	else if (type != ALLOC)
+	    dir->id[index].off = 0; /* a kill in mm_free/mm_realloc leaks it */
+	if (valid_op(trace, 0, i, &ranges) == 0)
+	    return 1;
+	trace->ops[i].type = type;
+	if (type != FREE) {
+	    dir->id[index].size = trace->block_sizes[index];
+	    dir->id[index].off = trace->blocks[index] - lo + 1;
+	}
+	dir->next_op = i + 1;
+    }
+    printf("Ran ops %d..%d of %s (%d ops)\n", first, last - 1, name, 
+	   trace->num_ops);
+    clear_ranges(&ranges);
+
+    if (last == trace->num_ops) { /* done: the next run starts over */
+	mm_set_root(NULL);
+	cur_mm->free(dir);
+	printf("Trace finished; the next run starts it again\n");
+    }
+    else if (die) {
+	printf("Killing the driver without mm_shutdown\n");
+	fflush(stdout);
+	kill(getpid(), SIGKILL);
+    }
+    mm_shutdown();
+    return 0;
+}
+
+/*
+ * eval_shared - Check the heap in the -S segment with n processes at
+ *     once. The driver formats the heap alone, then forks n workers
+ *     that map the segment again and each run the whole trace on it,
+ *     every worker with its own fill bytes. A block handed to two
+ *     workers, or written by one while another owns it, then shows up
+ *     as an overlap or fill error in one of them. Prints a line per
+ *     trace and returns the number of workers that passed.
+ */
+static int eval_shared(char *shm_name, char *name, trace_t *trace, 
+		       int tracenum, int n)
+{
+    range_t *ranges = NULL;
+    mm_stats_t st;
+    unsigned long long start;
+    pid_t pid;
+    int i, k, status, passed = 0;
+
+    mem_reset_brk();
+    if (cur_mm->init() < 0) {
+	malloc_error(tracenum, 0, "mm_init failed.");
+	return 0;
+    }
+    fflush(stdout);
+    start = lat_now();
+    for (k = 0; k < n; k++) {
+	if ((pid = fork()) < 0)
+	    unix_error("fork in eval_shared failed");
+	if (pid > 0)
+	    continue;
+
+	/* Worker: attach like another program would, no mm_init */
+	mem_deinit();
+	if (mem_init_shared(shm_name) != 0) {
+	    printf("ERROR: worker %d could not attach to %s\n", k, shm_name);
+	    fflush(stdout);
+	    _exit(1);
+	}
+	fill_salt = k;
+	trace_begin(trace);
+	for (i = 0; i < trace->num_ops; i++)
+	    if (valid_op(trace, tracenum, i, &ranges) == 0)
+		break;
+	fflush(stdout);
+	_exit(i < trace->num_ops);
+    }
+    while (wait(&status) > 0)
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+	    passed++;
+
+    mm_stats(&st);
+    printf("%s: %d of %d workers passed, %d ops each, %.3f secs; "
+	   "heap %lu bytes, %lu blocks live after\n", name, passed, n,
+	   trace->num_ops, (lat_now() - start) / 1e9,
+	   (unsigned long)st.heap_size, (unsigned long)st.live_blocks);
+    return passed;
+}
+
+/* 
  * eval_mm_util - Evaluate the space utilization of the student's package
  *   The idea is to remember the high water mark "hwm" of the heap for 
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the 
  *   size of the heap in bytes after running the student's malloc 
- *   package on the trace. Note that our implementation of mem_sbrk() 
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap. 
+ *   package on the trace. Since mem_sbrk() lets the allocator shrink
+ *   the heap, the heap size used here is the high water mark of the
+ *   brk pointer (mem_heap_peak), not its final value.
  *   
  */
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
@@ -706,11 +1885,13 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
     int total_size = 0;
     char *p;
     char *newp, *oldp;
+    int profile_at = heap_profile ? peak_op(trace) : -1;
 
     /* initialize the heap and the mm malloc package */
     mem_reset_brk();
-    if (mm_init() < 0)
+    if (cur_mm->init() < 0)
 	app_error("mm_init failed in eval_mm_util");
+    trace_begin(trace);
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
@@ -719,7 +1900,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if ((p = trace_malloc(trace, index, size)) == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -731,6 +1912,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    total_size += size;
 	    
 	    /* Update statistics */
+	    if (total_size > max_total_size && heap_peak != NULL)
+		mm_stats(&heap_peak[tracenum]);
 	    max_total_size = (total_size > max_total_size) ?
 		total_size : max_total_size;
 	    break;
@@ -741,7 +1924,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
+	    if ((newp = trace_realloc(trace, index, oldp, newsize)) == NULL)
 		app_error("mm_realloc failed in eval_mm_util");
 
 	    /* Remember region and size */
@@ -753,6 +1936,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    total_size += (newsize - oldsize);
 	    
 	    /* Update statistics */
+	    if (total_size > max_total_size && heap_peak != NULL)
+		mm_stats(&heap_peak[tracenum]);
 	    max_total_size = (total_size > max_total_size) ?
 		total_size : max_total_size;
 	    break;
@@ -762,7 +1947,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    trace_free(trace, index, p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -774,9 +1959,15 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    app_error("Nonexistent request type in eval_mm_util");
 
         }
+	if (compact_every && (i + 1) % compact_every == 0)
+	    trace_compact(trace);
+	if (i == profile_at)
+	    write_heap_profile(tracenum);
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    if (heap_end != NULL)
+	mm_stats(&heap_end[tracenum]);
+    return ((double)max_total_size / (double)mem_heap_peak());
 }
 
 
@@ -789,20 +1980,28 @@ static void eval_mm_speed(void *ptr)
     int i, index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    lat_hist_t *lat = ((speed_t *)ptr)->lat;
+    double *op_cycles = ((speed_t *)ptr)->op_cycles;
+    unsigned long long t0 = 0;
 
     /* Reset the heap and initialize the mm package */
     mem_reset_brk();
-    if (mm_init() < 0) 
+    if (cur_mm->init() < 0) 
 	app_error("mm_init failed in eval_mm_speed");
+    trace_begin(trace);
 
     /* Interpret each trace request */
-    for (i = 0;  i < trace->num_ops;  i++)
+    for (i = 0;  i < trace->num_ops;  i++) {
+	if (lat != NULL)
+	    t0 = lat_now();
+	else if (op_cycles != NULL)
+	    t0 = cyc_now();
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = trace_malloc(trace, index, size)) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
             break;
@@ -811,7 +2010,7 @@ static void eval_mm_speed(void *ptr)
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL)
+            if ((newp = trace_realloc(trace, index, oldp, newsize)) == NULL)
 		app_error("mm_realloc error in eval_mm_speed");
             trace->blocks[index] = newp;
             break;
@@ -819,12 +2018,19 @@ static void eval_mm_speed(void *ptr)
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+            trace_free(trace, index, block);
             break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
+	if (lat != NULL)
+	    lat_record(&lat[trace->ops[i].type], lat_now() - t0);
+	else if (op_cycles != NULL)
+	    op_cycles[trace->ops[i].type] += (double)(cyc_now() - t0) - cyc_ovhd;
+	if (compact_every && (i + 1) % compact_every == 0)
+	    trace_compact(trace);
+    }
 }
 
 /*
@@ -972,6 +2178,1240 @@ static void printresults(int n, stats_t *stats)
 	       "-");
     }
 
+    if (USE_PERF)
+	printcounters(n, stats);
+
+    /* Print where the time went, if -C measured it */
+    for (i=0; i < n && !stats[i].costs; i++)
+	;
+    if (i < n)
+	printcosts(n, stats);
+}
+
+/*
+ * printcounters - prints per trace the hardware events counted by
+ *     fperf around the timed runs (per run), then their totals
+ */
+static void printcounters(int n, stats_t *stats)
+{
+    static char *names[FPERF_EVENTS] = {
+	"cycles", "instrs", "L1D miss", "LLC miss", "dTLB miss", "br miss"
+    };
+    double total[FPERF_EVENTS] = {0};
+    int i, j, counted[FPERF_EVENTS];
+    double *hw;
+
+    for (j = 0; j < FPERF_EVENTS; j++)
+	counted[j] = 1;
+    printf("\nHardware counters (per run of the trace):\n");
+    printf("%5s", "trace");
+    for (j = 0; j < FPERF_EVENTS; j++)
+	printf("%12s", names[j]);
+    printf("%6s\n", "IPC");
+    for (i = 0; i <= n; i++) {
+	if (i < n) {
+	    if (!stats[i].valid)
+		continue;
+	    hw = stats[i].hw;
+	    for (j = 0; j < FPERF_EVENTS; j++) {
+		counted[j] &= (hw[j] >= 0);
+		total[j] += hw[j];
+	    }
+	    printf("%2d   ", i);
+	}
+	else {
+	    hw = total;
+	    for (j = 0; j < FPERF_EVENTS; j++)
+		if (!counted[j])
+		    total[j] = -1;
+	    printf("%-5s", "Total");
+	}
+	for (j = 0; j < FPERF_EVENTS; j++)
+	    if (hw[j] >= 0)
+		printf("%12.0f", hw[j]);
+	    else
+		printf("%12s", "-");
+	if (hw[FPERF_CYCLES] > 0 && hw[FPERF_INSTRUCTIONS] >= 0)
+	    printf("%6.2f\n", hw[FPERF_INSTRUCTIONS] / hw[FPERF_CYCLES]);
+	else
+	    printf("%6s\n", "-");
+    }
+}
+
+/*
+ * printcosts - prints per trace the Kcycles spent in each op type and,
+ *     inside them, in each allocator phase (from the extra -C pass)
+ */
+static void printcosts(int n, stats_t *stats)
+{
+    static char *phase_names[MM_PHASES] = {
+	"search", "split", "coalesce", "extend", "copy"
+    };
+    double total[3 + MM_PHASES + 1] = {0}, row[3 + MM_PHASES + 1];
+    int i, j;
+
+    printf("\nCost breakdown (Kcycles in one extra pass; phases run inside the ops):\n");
+    printf("%5s%9s%9s%9s", "trace", "malloc", "free", "realloc");
+    for (j = 0; j < MM_PHASES; j++)
+	printf("%9s", phase_names[j]);
+    printf("%9s\n", "copy KB");
+    for (i = 0; i <= n; i++) {
+	if (i < n) {
+	    if (!stats[i].costs)
+		continue;
+	    for (j = 0; j < 3; j++)
+		row[j] = stats[i].op_cycles[j] / 1e3;
+	    for (j = 0; j < MM_PHASES; j++)
+		row[3 + j] = stats[i].phase.cycles[j] / 1e3;
+	    row[3 + MM_PHASES] = stats[i].phase.copy_bytes / 1024.0;
+	    for (j = 0; j < 3 + MM_PHASES + 1; j++)
+		total[j] += row[j];
+	    printf("%2d   ", i);
+	}
+	else {
+	    memcpy(row, total, sizeof(row));
+	    printf("%-5s", "Total");
+	}
+	for (j = 0; j < 3 + MM_PHASES + 1; j++)
+	    printf("%9.0f", row[j]);
+	printf("\n");
+    }
+}
+
+/*
+ * metrics - names and values of the extended metrics of trace i that
+ *     this run measured, in a fixed order; NAN where the trace has none
+ */
+static int metrics(int i, stats_t *stats, sample_stats_t *st, 
+		   lat_hist_t *lat, int costs, char **name, double *val)
+{
+    static char *cost_names[3 + MM_PHASES + 1] = {
+	"malloc_kcycles", "free_kcycles", "realloc_kcycles", 
+	"search_kcycles", "split_kcycles", "coalesce_kcycles", 
+	"extend_kcycles", "copy_kcycles", "copy_kb"
+    };
+    static char *lat_names[3][4] = {
+	{"malloc_p50_ns", "malloc_p99_ns", "malloc_p999_ns", "malloc_max_ns"},
+	{"free_p50_ns", "free_p99_ns", "free_p999_ns", "free_max_ns"},
+	{"realloc_p50_ns", "realloc_p99_ns", "realloc_p999_ns", 
+	 "realloc_max_ns"}
+    };
+    static char *hw_names[FPERF_EVENTS] = {
+	"cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses",
+	"branch_misses"
+    };
+    static double pcts[3] = {50, 99, 99.9};
+    int valid = stats[i].valid;
+    lat_hist_t *h;
+    int j, t, k = 0;
+
+    if (st != NULL) {
+	name[k] = "median"; val[k++] = st[i].n ? st[i].median : NAN;
+	name[k] = "mad"; val[k++] = st[i].n ? st[i].mad : NAN;
+	name[k] = "ci_lo"; val[k++] = st[i].n ? st[i].lo : NAN;
+	name[k] = "ci_hi"; val[k++] = st[i].n ? st[i].hi : NAN;
+    }
+    if (costs) {
+	for (j = 0; j < 3 + MM_PHASES + 1; j++) {
+	    name[k] = cost_names[j];
+	    if (!stats[i].costs)
+		val[k] = NAN;
+	    else if (j < 3)
+		val[k] = stats[i].op_cycles[j] / 1e3;
+	    else if (j < 3 + MM_PHASES)
+		val[k] = stats[i].phase.cycles[j - 3] / 1e3;
+	    else
+		val[k] = stats[i].phase.copy_bytes / 1024.0;
+	    k++;
+	}
+    }
+    if (lat != NULL) {
+	for (t = 0; t < 3; t++) {
+	    h = &lat[3 * i + t];
+	    for (j = 0; j < 4; j++) {
+		name[k] = lat_names[t][j];
+		if (!valid || h->n == 0)
+		    val[k] = NAN;
+		else
+		    val[k] = j < 3 ? lat_percentile(h, pcts[j]) : h->max;
+		k++;
+	    }
+	}
+    }
+    if (USE_PERF) {
+	for (j = 0; j < FPERF_EVENTS; j++) {
+	    name[k] = hw_names[j];
+	    val[k++] = (valid && stats[i].hw[j] >= 0) ? stats[i].hw[j] : NAN;
+	}
+    }
+    return k;
+}
+
+/* Writes str as a JSON string literal */
+static void json_string(FILE *fp, char *str)
+{
+    fputc('"', fp);
+    for (; *str; str++) {
+	if (*str == '"' || *str == '\\')
+	    fprintf(fp, "\\%c", *str);
+	else if ((unsigned char)*str < 0x20)
+	    fprintf(fp, "\\u%04x", *str);
+	else
+	    fputc(*str, fp);
+    }
+    fputc('"', fp);
+}
+
+/* Writes str as a CSV field, quoted if it has to be */
+static void csv_string(FILE *fp, char *str)
+{
+    if (strpbrk(str, ",\"\n") == NULL) {
+	fputs(str, fp);
+	return;
+    }
+    fputc('"', fp);
+    for (; *str; str++) {
+	if (*str == '"')
+	    fputc('"', fp);
+	fputc(*str, fp);
+    }
+    fputc('"', fp);
+}
+
+/*
+ * writeresults - writes per trace validity, util, ops, secs, Kops and
+ *     the extended metrics, then the totals, as JSON (one trace per
+ *     line) or CSV (a header, one row per trace and a Total row). perf
+ *     is the perf index (util, thru, total), or NULL if there were errors.
+ */
+static void writeresults(FILE *fp, int format, int n, char **names, 
+			 stats_t *stats, sample_stats_t *st, lat_hist_t *lat,
+			 int costs, double *perf)
+{
+    char *name[MAX_METRICS];
+    double val[MAX_METRICS];
+    double secs = 0, ops = 0, util = 0;
+    int i, j, k = 0, numcorrect = 0;
+
+    if (format == FMT_JSON) {
+	fprintf(fp, "{\n  \"team\": ");
+	json_string(fp, team.teamname);
+	fprintf(fp, ",\n  \"traces\": [\n");
+    }
+    for (i = 0; i < n; i++) {
+	k = metrics(i, stats, st, lat, costs, name, val);
+	if (format == FMT_CSV && i == 0) {
+	    fprintf(fp, "trace,file,valid,util,ops,secs,kops");
+	    for (j = 0; j < k; j++)
+		fprintf(fp, ",%s", name[j]);
+	    fprintf(fp, "\n");
+	}
+	secs += stats[i].secs;
+	ops += stats[i].ops;
+	util += stats[i].util;
+	numcorrect += stats[i].valid;
+
+	if (format == FMT_JSON) {
+	    fprintf(fp, "    {\"trace\": %d, \"file\": ", i);
+	    json_string(fp, names[i]);
+	    fprintf(fp, ", \"valid\": %s", stats[i].valid ? "true" : "false");
+	    if (stats[i].valid)
+		fprintf(fp, ", \"util\": %.6f, \"ops\": %.0f, \"secs\": %.9f, "
+			"\"kops\": %.3f", stats[i].util, stats[i].ops, 
+			stats[i].secs, (stats[i].ops / stats[i].secs) / 1e3);
+	    for (j = 0; j < k; j++)
+		if (isnan(val[j]))
+		    fprintf(fp, ", \"%s\": null", name[j]);
+		else
+		    fprintf(fp, ", \"%s\": %.9g", name[j], val[j]);
+	    fprintf(fp, "}%s\n", i < n - 1 ? "," : "");
+	}
+	else {
+	    fprintf(fp, "%d,", i);
+	    csv_string(fp, names[i]);
+	    if (stats[i].valid)
+		fprintf(fp, ",1,%.6f,%.0f,%.9f,%.3f", stats[i].util, 
+			stats[i].ops, stats[i].secs, 
+			(stats[i].ops / stats[i].secs) / 1e3);
+	    else
+		fprintf(fp, ",0,,%.0f,,", stats[i].ops);
+	    for (j = 0; j < k; j++)
+		if (isnan(val[j]))
+		    fprintf(fp, ",");
+		else
+		    fprintf(fp, ",%.9g", val[j]);
+	    fprintf(fp, "\n");
+	}
+    }
+
+    if (format == FMT_JSON) {
+	fprintf(fp, "  ],\n  \"total\": {\"valid\": %d, \"util\": %.6f, "
+		"\"ops\": %.0f, \"secs\": %.9f, \"kops\": %.3f},\n", 
+		numcorrect, util / n, ops, secs, (ops / secs) / 1e3);
+	if (perf != NULL)
+	    fprintf(fp, "  \"perfindex\": {\"util\": %.3f, \"thru\": %.3f, "
+		    "\"total\": %.3f},\n", perf[0], perf[1], perf[2]);
+	else
+	    fprintf(fp, "  \"perfindex\": null,\n");
+	fprintf(fp, "  \"errors\": %d\n}\n", errors);
+    }
+    else {
+	fprintf(fp, "Total,,%d,%.6f,%.0f,%.9f,%.3f", numcorrect, util / n, 
+		ops, secs, (ops / secs) / 1e3);
+	for (j = 0; j < k; j++)
+	    fprintf(fp, ",");
+	fprintf(fp, "\n");
+    }
+}
+
+/*
+ * json_field - copies the value of "key" in a one-line JSON object
+ *     (as writeresults emits them) into val, without the quotes of a
+ *     string; returns 0 if the line has no such key
+ */
+static int json_field(char *line, char *key, char *val)
+{
+    char pat[MAXLINE];
+    char *p;
+
+    sprintf(pat, "\"%s\": ", key);
+    if ((p = strstr(line, pat)) == NULL)
+	return 0;
+    p += strlen(pat);
+    if (*p == '"') {
+	for (p++; *p && *p != '"'; p++) {
+	    if (*p == '\\' && p[1])
+		p++;
+	    *val++ = *p;
+	}
+    }
+    else
+	while (*p && *p != ',' && *p != '}')
+	    *val++ = *p++;
+    *val = '\0';
+    return 1;
+}
+
+/*
+ * csv_split - splits a CSV line in place into at most max fields and
+ *     returns how many there were
+ */
+static int csv_split(char *line, char **field, int max)
+{
+    char *src = line, *dst = line;
+    int n = 0, quoted;
+
+    while (n < max) {
+	field[n++] = dst;
+	quoted = (*src == '"');
+	if (quoted)
+	    src++;
+	while (*src && (quoted || (*src != ',' && *src != '\n'))) {
+	    if (quoted && *src == '"') {
+		if (src[1] != '"') {
+		    quoted = 0;
+		    src++;
+		    continue;
+		}
+		src++;
+	    }
+	    *dst++ = *src++;
+	}
+	if (*src != ',') {
+	    *dst = '\0';
+	    break;
+	}
+	src++;
+	*dst++ = '\0';
+    }
+    return n;
+}
+
+/*
+ * comparebaseline - compares this run with the results stored in file
+ *     (--format json or csv output of an earlier run), trace by trace
+ *     and in total. Throughput is compared on the runner medians when
+ *     both runs have them, else on secs. Returns the number of
+ *     regressions: a trace that became invalid, lost more than thru_tol
+ *     percent of its throughput, or more than util_tol points of util.
+ */
+static int comparebaseline(char *file, double thru_tol, double util_tol,
+			   int n, char **names, stats_t *stats, 
+			   sample_stats_t *st)
+{
+    FILE *fp;
+    char line[4 * MAXLINE], buf[MAXLINE], bname[MAXLINE];
+    char *field[3 * MAX_METRICS];
+    int col_file = -1, col_valid = -1, col_util = -1, col_secs = -1;
+    int col_median = -1;
+    int i, j, nf, json, found, bad, regressions = 0;
+    double bvalid, butil, bsecs, bmedian, secs, bs;
+    double ops = 0, tsecs = 0, tbsecs = 0, util = 0, tbutil = 0, change;
+    int matched = 0;
+
+    if ((fp = fopen(file, "r")) == NULL) {
+	sprintf(msg, "Could not open baseline %s", file);
+	unix_error(msg);
+    }
+    if (fgets(line, sizeof(line), fp) == NULL)
+	app_error("Empty baseline file");
+    json = (line[strspn(line, " \t")] == '{');
+    if (!json) { /* find the columns we need in the CSV header */
+	nf = csv_split(line, field, 3 * MAX_METRICS);
+	for (j = 0; j < nf; j++) {
+	    if (!strcmp(field[j], "file")) col_file = j;
+	    else if (!strcmp(field[j], "valid")) col_valid = j;
+	    else if (!strcmp(field[j], "util")) col_util = j;
+	    else if (!strcmp(field[j], "secs")) col_secs = j;
+	    else if (!strcmp(field[j], "median")) col_median = j;
+	}
+	if (col_file < 0 || col_valid < 0 || col_util < 0 || col_secs < 0)
+	    app_error("Baseline CSV lacks file, valid, util or secs columns");
+    }
+
+    printf("Baseline comparison with %s (allowed drop: throughput %.1f%%, "
+	   "util %.1f points):\n", file, thru_tol, util_tol);
+    printf("%5s %-20s%9s%9s%9s%7s%7s  %s\n", "trace", "file", "Kops", 
+	   "base", "change", "util", "base", "verdict");
+    for (i = 0; i < n; i++) {
+	/* Look up this trace's row in the baseline */
+	rewind(fp);
+	found = 0;
+	bvalid = butil = bsecs = 0;
+	bmedian = NAN;
+	while (!found && fgets(line, sizeof(line), fp) != NULL) {
+	    if (json) {
+		if (!json_field(line, "file", bname) || strcmp(bname, names[i]))
+		    continue;
+		found = 1;
+		bvalid = json_field(line, "valid", buf) && !strcmp(buf, "true");
+		butil = json_field(line, "util", buf) ? atof(buf) : 0;
+		bsecs = json_field(line, "secs", buf) ? atof(buf) : 0;
+		if (json_field(line, "median", buf) && strcmp(buf, "null"))
+		    bmedian = atof(buf);
+	    }
+	    else {
+		nf = csv_split(line, field, 3 * MAX_METRICS);
+		if (nf <= col_secs || nf <= col_util || 
+		    strcmp(field[col_file], names[i]))
+		    continue;
+		found = 1;
+		bvalid = atoi(field[col_valid]);
+		butil = atof(field[col_util]);
+		bsecs = atof(field[col_secs]);
+		if (col_median >= 0 && col_median < nf && *field[col_median])
+		    bmedian = atof(field[col_median]);
+	    }
+	}
+	if (!found) {
+	    printf("%2d    %-20s%9s\n", i, names[i], "-");
+	    continue;
+	}
+	if (!bvalid) {
+	    printf("%2d    %-20s%9s  not valid in the baseline\n", i, 
+		   names[i], "-");
+	    continue;
+	}
+	if (!stats[i].valid) {
+	    printf("%2d    %-20s%9s  REGRESSION: no longer valid\n", i, 
+		   names[i], "-");
+	    regressions++;
+	    continue;
+	}
+
+	/* Same measure on both sides */
+	if (st != NULL && st[i].n && !isnan(bmedian)) {
+	    secs = st[i].median;
+	    bs = bmedian;
+	}
+	else {
+	    secs = stats[i].secs;
+	    bs = bsecs;
+	}
+	change = (bs / secs - 1) * 100;   /* throughput change in % */
+	bad = (change < -thru_tol) || 
+	    ((butil - stats[i].util) * 100 > util_tol);
+	printf("%2d    %-20s%9.0f%9.0f%+8.1f%%%6.0f%%%6.0f%%  %s\n", i, 
+	       names[i], (stats[i].ops / secs) / 1e3, 
+	       (stats[i].ops / bs) / 1e3, change, stats[i].util * 100,
+	       butil * 100, bad ? "REGRESSION" : "ok");
+	regressions += bad;
+
+	matched++;
+	ops += stats[i].ops;
+	tsecs += secs;
+	tbsecs += bs;
+	util += stats[i].util;
+	tbutil += butil;
+    }
+    fclose(fp);
+
+    if (matched) {
+	change = (tbsecs / tsecs - 1) * 100;
+	bad = (change < -thru_tol) || ((tbutil - util) / matched * 100 > util_tol);
+	printf("%-26s%9.0f%9.0f%+8.1f%%%6.0f%%%6.0f%%  %s\n", "Total", 
+	       (ops / tsecs) / 1e3, (ops / tbsecs) / 1e3, change, 
+	       util / matched * 100, tbutil / matched * 100, 
+	       bad ? "REGRESSION" : "ok");
+	regressions += bad;
+    }
+    if (regressions)
+	printf("%d regression%s against %s\n", regressions, 
+	       regressions > 1 ? "s" : "", file);
+    return regressions;
+}
+
+/*
+ * load_plugins - dlopens each shared object in the comma-separated list
+ *     and looks up mm_init, mm_malloc, mm_free, mm_realloc and team in
+ *     it; returns the number of allocators loaded into *out
+ */
+static int load_plugins(char *list, allocator_t **out)
+{
+    allocator_t *a;
+    char path[MAXLINE];
+    char *tok;
+    void *h;
+    int n = 0;
+
+    if ((a = (allocator_t *)calloc(MAX_PLUGINS, sizeof(allocator_t))) == NULL)
+	unix_error("calloc failed in load_plugins");
+    for (tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ",")) {
+	if (n == MAX_PLUGINS) {
+	    fprintf(stderr, "At most %d allocators with -A\n", MAX_PLUGINS);
+	    exit(1);
+	}
+	/* A bare name would make dlopen search the library path */
+	sprintf(path, "%s%s", strchr(tok, '/') ? "" : "./", tok);
+
+	/* RTLD_LOCAL keeps the plugins' symbols apart; their own calls
+	   bind inside them because they are linked -Bsymbolic */
+	if ((h = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL) {
+	    fprintf(stderr, "%s\n", dlerror());
+	    exit(1);
+	}
+	a[n].name = strdup(tok);
+	a[n].team = (team_t *)dlsym(h, "team");
+	a[n].init = (int (*)(void))dlsym(h, "mm_init");
+	a[n].malloc = (void *(*)(size_t))dlsym(h, "mm_malloc");
+	a[n].free = (void (*)(void *))dlsym(h, "mm_free");
+	a[n].realloc = (void *(*)(void *, size_t))dlsym(h, "mm_realloc");
+	if (!a[n].team || !a[n].init || !a[n].malloc || !a[n].free || 
+	    !a[n].realloc) {
+	    fprintf(stderr, "%s does not export mm_init, mm_malloc, mm_free, "
+		    "mm_realloc and team\n", tok);
+	    exit(1);
+	}
+	n++;
+    }
+    if (n == 0) {
+	fprintf(stderr, "No allocators in -A %s\n", list);
+	exit(1);
+    }
+    *out = a;
+    return n;
+}
+
+/*
+ * eval_plugins - checks, measures and times every allocator on every
+ *     trace, interleaved: each trace is read once and run by all of
+ *     them back to back, with the one that goes first rotating from
+ *     trace to trace so that none always gets the cold caches.
+ */
+static void eval_plugins(int na, allocator_t *a, int n, char **names,
+			 int samples, int warmups)
+{
+    stats_t *stats = (stats_t *)calloc(na * n, sizeof(stats_t));
+    sample_stats_t *st = NULL;
+    int *errs = (int *)calloc(na, sizeof(int));
+    range_t *ranges = NULL;
+    trace_t *trace;
+    speed_t speed_params;
+    stats_t *s;
+    int i, j, k, e;
+
+    if (stats == NULL || errs == NULL)
+	unix_error("calloc failed in eval_plugins");
+    if (samples && 
+	(st = (sample_stats_t *)calloc(na * n, sizeof(sample_stats_t))) == NULL)
+	unix_error("calloc failed in eval_plugins");
+    memset(&speed_params, 0, sizeof(speed_params));
+
+    for (i = 0; i < n; i++) {
+	trace = read_trace(tracedir, names[i]);
+	for (j = 0; j < na; j++) {
+	    k = (i + j) % na;
+	    cur_mm = &a[k];
+	    s = &stats[k * n + i];
+	    e = errors;
+	    if (verbose > 1)
+		printf("Checking %s for correctness, ", a[k].name);
+	    s->ops = trace->num_ops;
+	    s->valid = eval_mm_valid(trace, i, &ranges);
+	    if (s->valid) {
+		if (verbose > 1)
+		    printf("efficiency, and performance.\n");
+		s->util = eval_mm_util(trace, i, &ranges);
+		speed_params.trace = trace;
+		speed_params.ranges = ranges;
+		s->secs = fsecs(eval_mm_speed, &speed_params);
+		if (samples)
+		    run_samples(&speed_params, warmups, samples, 
+				&st[k * n + i]);
+	    }
+	    errs[k] += errors - e;
+	}
+	free_trace(trace);
+    }
+    cur_mm = &linked_mm;
+
+    printplugins(na, a, n, names, stats, st, errs);
+    free(stats);
+    free(st);
+    free(errs);
+}
+
+/*
+ * printplugins - prints util and Kops of every allocator side by side,
+ *     per trace and in total (for up to PLUGIN_COLUMNS of them), then
+ *     ranks them by perf index (ties by throughput). With runner
+ *     samples the Kops are from the medians.
+ */
+static void printplugins(int na, allocator_t *a, int n, char **names,
+			 stats_t *stats, sample_stats_t *st, int *errs)
+{
+    double *secs = (double *)calloc(na, sizeof(double));
+    double *util = (double *)calloc(na, sizeof(double));
+    double *perf = (double *)calloc(na, sizeof(double));
+    int *rank = (int *)calloc(na, sizeof(int));
+    int table = (na <= PLUGIN_COLUMNS);
+    double ops = 0, t, p1, p2;
+    char head[2][16];
+    stats_t *s;
+    int i, j, k;
+
+    if (secs == NULL || util == NULL || perf == NULL || rank == NULL)
+	unix_error("calloc failed in printplugins");
+
+    printf("\nAllocators:\n");
+    for (k = 0; k < na; k++)
+	printf("%4d  %s (team %s)\n", k + 1, a[k].name, a[k].team->teamname);
+    if (table) {
+	printf("\n%5s %-20s", "trace", "file");
+	for (k = 0; k < na; k++) {
+	    sprintf(head[0], "%d util", k + 1);
+	    sprintf(head[1], "%d Kops", k + 1);
+	    printf("%8s%8s", head[0], head[1]);
+	}
+	printf("\n");
+    }
+    for (i = 0; i < n; i++) {
+	if (table)
+	    printf("%2d    %-20s", i, names[i]);
+	for (k = 0; k < na; k++) {
+	    s = &stats[k * n + i];
+	    if (!s->valid) {
+		if (table)
+		    printf("%8s%8s", "-", "-");
+		continue;
+	    }
+	    t = (st != NULL) ? st[k * n + i].median : s->secs;
+	    secs[k] += t;
+	    util[k] += s->util;
+	    if (table)
+		printf("%7.0f%%%8.0f", s->util * 100.0, (s->ops / t) / 1e3);
+	}
+	ops += stats[i].ops;
+	if (table)
+	    printf("\n");
+    }
+
+    /* Same perf index as main, 0 with errors */
+    for (k = 0; k < na; k++) {
+	util[k] /= n;
+	if (errs[k])
+	    perf[k] = 0;
+	else {
+	    p1 = UTIL_WEIGHT * util[k];
+	    t = ops / secs[k];
+	    p2 = (1.0 - UTIL_WEIGHT) * (t > AVG_LIBC_THRUPUT ? 1.0 : 
+					t / AVG_LIBC_THRUPUT);
+	    perf[k] = (p1 + p2) * 100.0;
+	}
+    }
+    if (table) {
+	printf("%-26s", "Total");
+	for (k = 0; k < na; k++)
+	    if (errs[k])
+		printf("%8s%8s", "-", "-");
+	    else
+		printf("%7.0f%%%8.0f", util[k] * 100.0, (ops / secs[k]) / 1e3);
+	printf("\n%-26s", "Perf index");
+	for (k = 0; k < na; k++)
+	    printf("%16.0f", perf[k]);
+	printf("\n");
+    }
+
+    /* Insertion sort by perf index, then throughput */
+    for (k = 0; k < na; k++) {
+	for (j = k; j > 0; j--) {
+	    i = rank[j - 1];
+	    if (perf[i] > perf[k] || 
+		(perf[i] == perf[k] && secs[i] <= secs[k]))
+		break;
+	    rank[j] = i;
+	}
+	rank[j] = k;
+    }
+    printf("\nRanking:\n");
+    for (j = 0; j < na; j++) {
+	k = rank[j];
+	printf("%4d. %3d  %-36s", j + 1, k + 1, a[k].name);
+	if (errs[k])
+	    printf("%d errors\n", errs[k]);
+	else
+	    printf("%3.0f/100  (util %.0f%%, %.0f Kops)\n", perf[k], 
+		   util[k] * 100.0, (ops / secs[k]) / 1e3);
+    }
+    free(secs);
+    free(util);
+    free(perf);
+    free(rank);
+}
+
+/*
+ * lat_now - monotonic time in ns, for per-op latencies
+ */
+static unsigned long long lat_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * cyc_now - cycle counter, the same one mm.c's phase profiling reads
+ *     (rdtsc on x86, CLOCK_MONOTONIC ns elsewhere)
+ */
+static unsigned long long cyc_now(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    unsigned lo, hi;
+
+    __asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+#else
+    return lat_now();
+#endif
+}
+
+/*
+ * timer_ovhd - median cost of a back-to-back pair of now() calls,
+ *     i.e. what an empty timed op would measure
+ */
+static unsigned long long timer_ovhd(unsigned long long (*now)(void))
+{
+    lat_hist_t *h = (lat_hist_t *)calloc(1, sizeof(lat_hist_t));
+    unsigned long long t0, d, ovhd;
+    int i;
+
+    if (h == NULL)
+	unix_error("calloc failed in timer_ovhd");
+    for (i = 0; i < 10000; i++) {
+	t0 = now();
+	d = now() - t0;
+	h->count[lat_bucket(d)]++;
+	h->n++;
+	if (d > h->max)
+	    h->max = d;
+    }
+    ovhd = lat_percentile(h, 50);
+    free(h);
+    return ovhd;
+}
+
+/* Bucket of value v, and the largest value that lands in bucket b */
+static int lat_bucket(unsigned long long v)
+{
+    int shift;
+
+    if (v < (1 << LAT_SUB_BITS))
+	return (int)v;
+    shift = 63 - __builtin_clzll(v) - LAT_SUB_BITS;
+    return ((shift + 1) << LAT_SUB_BITS) + (int)(v >> shift) - (1 << LAT_SUB_BITS);
+}
+
+static unsigned long long lat_bucket_high(int b)
+{
+    int shift = (b >> LAT_SUB_BITS) - 1;
+
+    if (shift < 0)
+	return b;
+    return ((unsigned long long)((b & ((1 << LAT_SUB_BITS) - 1)) + 
+				 (1 << LAT_SUB_BITS) + 1) << shift) - 1;
+}
+
+/*
+ * lat_record - adds one op that took ns (timer overhead not yet removed)
+ */
+static void lat_record(lat_hist_t *h, unsigned long long ns)
+{
+    ns = ns > lat_ovhd ? ns - lat_ovhd : 0;
+    h->count[lat_bucket(ns)]++;
+    h->n++;
+    if (ns > h->max)
+	h->max = ns;
+}
+
+/*
+ * lat_percentile - smallest bucket value that at least pct percent of
+ *     the recorded ops do not exceed (capped at the exact max)
+ */
+static unsigned long long lat_percentile(lat_hist_t *h, double pct)
+{
+    unsigned long long want = (unsigned long long)(pct / 100.0 * h->n + 0.999999);
+    unsigned long long seen = 0;
+    int b;
+
+    if (h->n == 0)
+	return 0;
+    if (want == 0)
+	want = 1;
+    for (b = 0; b < LAT_BUCKETS; b++) {
+	seen += h->count[b];
+	if (seen >= want)
+	    break;
+    }
+    return lat_bucket_high(b) < h->max ? lat_bucket_high(b) : h->max;
+}
+
+/*
+ * printlatency - prints p50, p99, p99.9 and max per trace and op type,
+ *     then the same over all traces
+ */
+static void printlatency(int n, lat_hist_t *lat)
+{
+    static char *op_names[] = {"malloc", "free", "realloc"}; /* by op type */
+    lat_hist_t *all = (lat_hist_t *)calloc(3, sizeof(lat_hist_t));
+    lat_hist_t *h;
+    int i, t, b;
+
+    if (all == NULL)
+	unix_error("calloc failed in printlatency");
+    printf("%5s  %-8s%10s%8s%8s%8s%10s\n", 
+	   "trace", "op", "ops", "p50", "p99", "p99.9", "max");
+    for (i = 0; i <= n; i++) {
+	for (t = 0; t < 3; t++) {
+	    h = (i < n) ? &lat[3 * i + t] : &all[t];
+	    if (h->n == 0)
+		continue;
+	    if (i < n) {
+		printf("%2d", i);
+		for (b = 0; b < LAT_BUCKETS; b++)
+		    all[t].count[b] += h->count[b];
+		all[t].n += h->n;
+		if (h->max > all[t].max)
+		    all[t].max = h->max;
+	    }
+	    else
+		printf("%-5s", "Total");
+	    printf("%*s%-8s%10llu%8llu%8llu%8llu%10llu\n", 
+		   i < n ? 5 : 2, "", op_names[t], h->n,
+		   lat_percentile(h, 50), lat_percentile(h, 99),
+		   lat_percentile(h, 99.9), h->max);
+	}
+    }
+    free(all);
+}
+
+/*
+ * pin_cpu - keep the driver on one CPU, so the samples aren't spread
+ *     over cores with different caches and clock states
+ */
+static void pin_cpu(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+	sprintf(msg, "Could not pin to CPU %d", cpu);
+	unix_error(msg);
+    }
+}
+
+/*
+ * run_samples - the runner: warmups untimed runs of eval_mm_speed,
+ *     then n timed ones, summarized by their median, MAD, and a 95%
+ *     confidence interval of the median
+ */
+static void run_samples(speed_t *params, int warmups, int n, 
+			sample_stats_t *st)
+{
+    double *x = (double *)malloc(n * sizeof(double));
+    double *dev = (double *)malloc(n * sizeof(double));
+    unsigned long long t0;
+    double z;
+    int i, lo, hi;
+
+    if (x == NULL || dev == NULL)
+	unix_error("malloc failed in run_samples");
+    for (i = 0; i < warmups; i++)
+	eval_mm_speed(params);
+    for (i = 0; i < n; i++) {
+	t0 = lat_now();
+	eval_mm_speed(params);
+	x[i] = (lat_now() - t0) / 1e9;
+    }
+
+    qsort(x, n, sizeof(double), cmp_double);
+    st->n = n;
+    st->ops = params->trace->num_ops;
+    st->median = (n % 2) ? x[n/2] : (x[n/2 - 1] + x[n/2]) / 2;
+    for (i = 0; i < n; i++)
+	dev[i] = x[i] > st->median ? x[i] - st->median : st->median - x[i];
+    qsort(dev, n, sizeof(double), cmp_double);
+    st->mad = (n % 2) ? dev[n/2] : (dev[n/2 - 1] + dev[n/2]) / 2;
+
+    /* Distribution-free interval from order statistics: the number of
+       samples below the true median is Binomial(n, 1/2), so ranks
+       n/2 -+ 1.96 sqrt(n)/2 bracket it with ~95% confidence. Timings
+       are skewed (interrupts only ever add time), so no normal CI. */
+    z = 1.96 * sqrt((double)n) / 2;
+    lo = (int)floor(n / 2.0 - z);
+    hi = (int)ceil(n / 2.0 + z);
+    st->lo = x[lo < 0 ? 0 : lo];
+    st->hi = x[hi > n - 1 ? n - 1 : hi];
+    free(x);
+    free(dev);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * printsamples - prints per trace the runner's median secs, MAD and the
+ *     confidence interval of the median, then the sum of the medians
+ */
+static void printsamples(int n, char **names, sample_stats_t *st)
+{
+    double secs = 0, ops = 0;
+    int i;
+
+    printf("%5s %-20s%10s%10s%24s%7s\n", 
+	   "trace", "file", "median", "MAD", "95% CI of median", "Kops");
+    for (i = 0; i < n; i++) {
+	if (st[i].n == 0)
+	    continue;
+	printf("%2d    %-20s%10.6f%10.6f   [%.6f, %.6f]%7.0f\n",
+	       i, names[i], st[i].median, st[i].mad, st[i].lo, st[i].hi, 
+	       (st[i].ops / st[i].median) / 1e3);
+	secs += st[i].median;
+	ops += st[i].ops;
+    }
+    if (secs > 0)
+	printf("%-26s%10.6f%34s%7.0f\n", "Total", secs, "", (ops / secs) / 1e3);
+}
+
+/*
+ * savesamples - writes the runner's summary as "file median mad lo hi n"
+ *     lines, for a later run to compare against with -c
+ */
+static void savesamples(char *file, int n, char **names, sample_stats_t *st)
+{
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(file, "w")) == NULL) {
+	sprintf(msg, "Could not open %s", file);
+	unix_error(msg);
+    }
+    fprintf(fp, "# mdriver runner samples: file median mad lo hi n\n");
+    for (i = 0; i < n; i++)
+	if (st[i].n)
+	    fprintf(fp, "%s %.9f %.9f %.9f %.9f %d\n", names[i], st[i].median,
+		    st[i].mad, st[i].lo, st[i].hi, st[i].n);
+    fclose(fp);
+    printf("Runner samples saved to %s\n", file);
+}
+
+/*
+ * comparesamples - compares the runner's medians with those saved in
+ *     file, trace by trace. A change is only called faster or slower
+ *     when the two confidence intervals are disjoint; otherwise it is
+ *     flagged as inside the noise.
+ */
+static void comparesamples(char *file, int n, char **names, 
+			   sample_stats_t *st)
+{
+    FILE *fp;
+    char line[MAXLINE], name[MAXLINE];
+    sample_stats_t old;
+    double secs = 0, old_secs = 0;
+    int i, found, noise = 0;
+
+    if ((fp = fopen(file, "r")) == NULL) {
+	sprintf(msg, "Could not open %s", file);
+	unix_error(msg);
+    }
+    printf("Compared with %s (this run vs. saved):\n", file);
+    printf("%5s %-20s%10s%10s%9s  %s\n", 
+	   "trace", "file", "this", "saved", "change", "verdict");
+    for (i = 0; i < n; i++) {
+	if (st[i].n == 0)
+	    continue;
+	rewind(fp);
+	found = 0;
+	while (!found && fgets(line, MAXLINE, fp) != NULL)
+	    found = line[0] != '#' && 
+		sscanf(line, "%s %lf %lf %lf %lf %d", name, &old.median, 
+		       &old.mad, &old.lo, &old.hi, &old.n) == 6 &&
+		!strcmp(name, names[i]);
+	if (!found) {
+	    printf("%2d    %-20s%10.6f%10s\n", i, names[i], st[i].median, "-");
+	    continue;
+	}
+	printf("%2d    %-20s%10.6f%10.6f%+8.1f%%  ", i, names[i], 
+	       st[i].median, old.median, 
+	       (st[i].median / old.median - 1) * 100);
+	if (st[i].hi < old.lo)
+	    printf("faster\n");
+	else if (st[i].lo > old.hi)
+	    printf("slower\n");
+	else {
+	    printf("CIs overlap (noise)\n");
+	    noise++;
+	}
+	secs += st[i].median;
+	old_secs += old.median;
+    }
+    fclose(fp);
+    if (old_secs > 0)
+	printf("%-26s%10.6f%10.6f%+8.1f%%  %d of the differences are "
+	       "inside the noise\n", "Total", secs, old_secs, 
+	       (secs / old_secs - 1) * 100, noise);
+}
+
+/*
+ * printpools - prints per trace how many pools and slabs -O used and
+ *     how much of the slabs the objects filled at their peak
+ */
+static void printpools(int n, pool_sum_t *sum)
+{
+    int i;
+    size_t hw = 0, cap = 0;
+
+    printf("%5s%8s%8s%10s%10s%8s%7s\n", 
+	   "trace", "pools", "slabs", "capacity", "peak objs", "left", "fill");
+    for (i=0; i < n; i++) {
+	printf("%2d%11d%8lu%10lu%10lu%8lu%6.0f%%\n",
+	       i,
+	       sum[i].pools,
+	       (unsigned long)sum[i].slabs,
+	       (unsigned long)sum[i].capacity,
+	       (unsigned long)sum[i].high_water,
+	       (unsigned long)sum[i].in_use,
+	       sum[i].capacity ? 100.0 * sum[i].high_water / sum[i].capacity : 0.0);
+	hw += sum[i].high_water;
+	cap += sum[i].capacity;
+    }
+    printf("%-49s%6.0f%%\n", "Total", cap ? 100.0 * hw / cap : 0.0);
+}
+
+/*
+ * printdeferred - prints per trace how many deferred frees the
+ *     background thread and malloc itself drained, and the lag from
+ *     mm_free until the block was back on the free list.
+ */
+static void printdeferred(int n, mm_deferred_stats_t *def)
+{
+    int i;
+    double drained, lag = 0, all_drained = 0, max_lag = 0;
+
+    printf("%5s%10s%10s%10s%9s%11s%11s\n", 
+	   "trace", "deferred", "bg", "fg", "fg runs", "lag avg us", "lag max us");
+    for (i=0; i < n; i++) {
+	drained = def[i].drained_bg + def[i].drained_fg;
+	printf("%2d%13lu%10lu%10lu%9lu%11.1f%11.1f\n",
+	       i,
+	       (unsigned long)def[i].deferred,
+	       (unsigned long)def[i].drained_bg,
+	       (unsigned long)def[i].drained_fg,
+	       (unsigned long)def[i].fg_drains,
+	       def[i].lag_avg_us,
+	       def[i].lag_max_us);
+	lag += def[i].lag_avg_us * drained;
+	all_drained += drained;
+	if (def[i].lag_max_us > max_lag)
+	    max_lag = def[i].lag_max_us;
+    }
+    printf("%-44s%11.1f%11.1f\n", "Total", 
+	   all_drained > 0 ? lag/all_drained : 0.0, max_lag);
+}
+
+/*
+ * printfits - prints per trace how many free list nodes find_fit
+ *     visited and how many cycles each visit took on average.
+ */
+static void printfits(int n, mm_fit_stats_t *fit)
+{
+    int i;
+    double all_visits = 0, all_cycles = 0;
+
+    printf("%5s%10s%12s%11s%12s\n", 
+	   "trace", "fits", "nodes", "nodes/fit", "cyc/node");
+    for (i=0; i < n; i++) {
+	printf("%2d%13lu%12lu%11.1f%12.2f\n",
+	       i,
+	       (unsigned long)fit[i].fits,
+	       (unsigned long)fit[i].visits,
+	       fit[i].fits > 0 ? (double)fit[i].visits/fit[i].fits : 0.0,
+	       fit[i].visits > 0 ? (double)fit[i].cycles/fit[i].visits : 0.0);
+	all_visits += fit[i].visits;
+	all_cycles += fit[i].cycles;
+    }
+    printf("%-38s%12.2f\n", "Total", 
+	   all_visits > 0 ? all_cycles/all_visits : 0.0);
+}
+
+/*
+ * peak_op - index of the op after which the live payload of the trace
+ *   first reaches its maximum (what eval_mm_util calls max_total_size)
+ */
+static int peak_op(trace_t *trace)
+{
+    int i, at = -1, total = 0, max_total = 0;
+    int *sizes = (int *)calloc(trace->num_ids, sizeof(int));
+
+    if (sizes == NULL)
+	unix_error("calloc failed in peak_op");
+    for (i = 0; i < trace->num_ops; i++) {
+	if (trace->ops[i].type == FREE) {
+	    total -= sizes[trace->ops[i].index];
+	    sizes[trace->ops[i].index] = 0;
+	    continue;
+	}
+	total += trace->ops[i].size - sizes[trace->ops[i].index];
+	sizes[trace->ops[i].index] = trace->ops[i].size;
+	if (total > max_total) {
+	    max_total = total;
+	    at = i;
+	}
+    }
+    free(sizes);
+    return at;
+}
+
+/*
+ * write_heap_profile - writes mm_heap_profile to mdriver-heap.<tracenum>
+ */
+static void write_heap_profile(int tracenum)
+{
+    char path[MAXLINE];
+    FILE *fp;
+
+    sprintf(path, "mdriver-heap.%d", tracenum);
+    if ((fp = fopen(path, "w")) == NULL)
+	unix_error(path);
+    if (mm_heap_profile(fp) < 0)
+	app_error("mm_heap_profile failed");
+    fclose(fp);
+}
+
+/*
+ * printheap - prints mm_stats per trace: the heap at the peak of live
+ *     payload, then the counters at the end of the trace: sbrk calls,
+ *     coalesce cases, and percentiles of the nodes find_fit visited
+ *     (upper bounds of the power-of-two histogram buckets).
+ */
+static unsigned long search_pct(mm_stats_t *st, double pct)
+{
+    unsigned long total = 0, seen = 0;
+    int b;
+
+    for (b = 0; b < MM_STATS_SEARCHES; b++)
+	total += st->fit_search[b];
+    if (total == 0)
+	return 0;
+    for (b = 0; b < MM_STATS_SEARCHES; b++) {
+	seen += st->fit_search[b];
+	if (seen > 0 && seen >= pct * total)
+	    break;
+    }
+    return b == 0 ? 0 : (1UL << b) - 1;
+}
+
+static void printheap(int n, mm_stats_t *peak, mm_stats_t *end)
+{
+    int i;
+
+    printf("Heap at peak payload for mm malloc:\n");
+    printf("%5s%10s%10s%8s%10s%8s%10s%8s%7s\n", 
+	   "trace", "heap", "live", "blocks", "free", "fblocks", "largest", "extfrag", "sbrk");
+    for (i=0; i < n; i++) {
+	printf("%2d%13lu%10lu%8lu%10lu%8lu%10lu%7.0f%%%7lu\n",
+	       i,
+	       (unsigned long)peak[i].heap_size,
+	       (unsigned long)peak[i].live_bytes,
+	       (unsigned long)peak[i].live_blocks,
+	       (unsigned long)peak[i].free_bytes,
+	       (unsigned long)peak[i].free_blocks,
+	       (unsigned long)peak[i].largest_free,
+	       peak[i].ext_frag*100.0,
+	       (unsigned long)end[i].extend_calls);
+    }
+
+    printf("\nCoalesce cases and find_fit nodes visited for mm malloc:\n");
+    printf("%5s%8s%8s%8s%8s%8s%8s%8s\n", 
+	   "trace", "none", "next", "prev", "both", "p50", "p90", "p99");
+    for (i=0; i < n; i++) {
+	printf("%2d%11lu%8lu%8lu%8lu%8lu%8lu%8lu\n",
+	       i,
+	       (unsigned long)end[i].coalesce[0],
+	       (unsigned long)end[i].coalesce[1],
+	       (unsigned long)end[i].coalesce[2],
+	       (unsigned long)end[i].coalesce[3],
+	       search_pct(&end[i], 0.50),
+	       search_pct(&end[i], 0.90),
+	       search_pct(&end[i], 0.99));
+    }
+}
+
+/*
+ * printlifetimes - prints the lifetime predictor's accuracy per trace.
+ *     short/long columns count right/wrong predictions; only lifetimes
+ *     the allocator observed are counted.
+ */
+static void printlifetimes(int n, mm_lifetime_stats_t *life)
+{
+    int i;
+    double right, total;
+    double all_right = 0, all_total = 0;
+
+    printf("%5s%14s%14s%6s%9s%7s\n", 
+	   "trace", "short ok/bad", "long ok/bad", "acc", "nursery", "resets");
+    for (i=0; i < n; i++) {
+	right = life[i].short_right + life[i].long_right;
+	total = right + life[i].short_wrong + life[i].long_wrong;
+	printf("%2d%10lu/%-6lu%7lu/%-6lu%5.0f%%%9lu%7lu\n",
+	       i,
+	       (unsigned long)life[i].short_right,
+	       (unsigned long)life[i].short_wrong,
+	       (unsigned long)life[i].long_right,
+	       (unsigned long)life[i].long_wrong,
+	       total > 0 ? right/total*100.0 : 0.0,
+	       (unsigned long)life[i].nursery_allocs,
+	       (unsigned long)life[i].nursery_resets);
+	all_right += right;
+	all_total += total;
+    }
+    printf("%-33s%5.0f%%\n", "Total", 
+	   all_total > 0 ? all_right/all_total*100.0 : 0.0);
 }
 
 /* 
@@ -1006,14 +3446,44 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValCDFLMNRT] [-f <file>] [-t <dir>] [-A <a.so,b.so,...>] [-H <bytes>] [-K <n>] [-O <bytes>] [-P <policy>] [-S <shm> [-j <n>]]\n");
+    fprintf(stderr, "               [-W <file> [-E <n> [-k]]]\n");
+    fprintf(stderr, "               [-r <n> [-w <n>] [-p <cpu>] [-s <file>] [-c <file>]]\n");
+    fprintf(stderr, "               [--format=text|json|csv] [--baseline <file> [--thru-threshold=<pct>] [--util-threshold=<pts>]]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-A <list>  Rank the allocators in the comma-separated .so files side by side.\n");
+    fprintf(stderr, "\t-c <file>  Compare the runner samples with those saved in <file>.\n");
+    fprintf(stderr, "\t-C         Break one extra pass down by op type and allocator phase.\n");
+    fprintf(stderr, "\t-D         Deferred free with a background coalescing thread.\n");
+    fprintf(stderr, "\t-E <n>     With -W, stop this run after <n> ops.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-F         Time the free list searches; report cycles per node.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-j <n>     With -S, run each trace in <n> processes on the one shared heap.\n");
+    fprintf(stderr, "\t-H <bytes> Sample the heap every <bytes>; write pprof heap profiles.\n");
+    fprintf(stderr, "\t-k         With -W -E, kill the driver at the stop instead of shutting down.\n");
+    fprintf(stderr, "\t-K <n>     Allocate movable blocks; compact the heap every <n> ops.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L         Time each op of one extra speed pass; report p50/p99/p99.9/max.\n");
+    fprintf(stderr, "\t-M         Report heap stats at peak payload and allocator counters.\n");
+    fprintf(stderr, "\t-N         Lifetime prediction with a nursery; report accuracy.\n");
+    fprintf(stderr, "\t-O <bytes> Serve requests up to <bytes> from one object pool per size.\n");
+    fprintf(stderr, "\t-p <cpu>   Pin the driver to CPU <cpu>.\n");
+    fprintf(stderr, "\t-P <pol>   Placement policy: first, next, best, good, adaptive.\n");
+    fprintf(stderr, "\t-r <n>     Runner: time <n> runs per trace; report median, MAD, 95%% CI.\n");
+    fprintf(stderr, "\t-R         Use regions for ids grouped by \"g\" lines.\n");
+    fprintf(stderr, "\t-s <file>  Save the runner samples to <file>.\n");
+    fprintf(stderr, "\t-S <shm>   Put the heap in shared-memory segment <shm> (e.g. /mm).\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T         Two-ended placement (large blocks from the top).\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
+    fprintf(stderr, "\t-w <n>     Warm-up runs before the runner samples (default 3).\n");
+    fprintf(stderr, "\t-W <file>  Run the first trace on a heap kept in <file>, going on from the last run.\n");
+    fprintf(stderr, "\t--format=<fmt>      Write json or csv results to stdout (the report goes to stderr).\n");
+    fprintf(stderr, "\t--baseline <file>   Compare with stored json/csv results; exit 2 on a regression.\n");
+    fprintf(stderr, "\t--thru-threshold=<pct>  Allowed throughput drop against the baseline (default 10%%).\n");
+    fprintf(stderr, "\t--util-threshold=<pts>  Allowed utilization drop in points (default 1).\n");
 }
@@ -8,6 +8,9 @@
 #include <assert.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <string.h>
 #include <errno.h>
 
@@ -18,6 +21,37 @@
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+static char *mem_peak_brk;   /* highest brk since the last reset */
+
+/*
+ * Shared mode (mem_init_shared, mem_init_file): the heap lives in a
+ * named POSIX shared-memory segment or a file that processes may map
+ * at different addresses. The segment starts with this header page;
+ * the brk is kept there as an offset so that every process, and the
+ * next run of a file-backed heap, sees the same heap.
+ */
+#define MEM_SHARED_MAGIC 0x6d656d6c6962736dULL
+#define MEM_SHARED_HDR   4096  /* header page in front of the heap */
+
+typedef struct {
+    unsigned long long magic;
+    size_t brk;                /* heap size in bytes */
+    size_t peak;               /* largest heap size since the last reset */
+    int ready;                 /* set by the creator once the lock is usable */
+    pthread_mutex_t lock;      /* process-shared lock for the allocator */
+    char area[MEM_SHARED_AREA] __attribute__((aligned(16))); /* allocator roots */
+} mem_shared_t;
+typedef char mem_shared_fits[sizeof(mem_shared_t) <= MEM_SHARED_HDR ? 1 : -1];
+
+static mem_shared_t *mem_shared = NULL; /* NULL unless in shared mode */
+
+/* In shared mode the brk may have moved in another process */
+#define BRK_LOAD() \
+    do { if (mem_shared) { mem_brk = mem_start_brk + mem_shared->brk; \
+                           mem_peak_brk = mem_start_brk + mem_shared->peak; } } while (0)
+#define BRK_STORE() \
+    do { if (mem_shared) { mem_shared->brk = mem_brk - mem_start_brk; \
+                           mem_shared->peak = mem_peak_brk - mem_start_brk; } } while (0)
 
 /* 
  * mem_init - initialize the memory system model
@@ -32,6 +66,162 @@ void mem_init(void)
 
     mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
     mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_peak_brk = mem_start_brk;
+}
+
+/*
+ * mem_map - map the header page plus heap of an open segment (shared
+ *    memory or file) and make it the simulated heap. If init_lock is
+ *    set, (re)initialize the header's lock; a new segment also gets a
+ *    fresh header. Returns 0 on success, -1 on error.
+ */
+static int mem_map(int fd, int created, int init_lock)
+{
+    size_t size = MEM_SHARED_HDR + MAX_HEAP;
+    void *p;
+
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+	return -1;
+
+    mem_shared = (mem_shared_t *)p;
+    if (init_lock) {
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutex_init(&mem_shared->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+    }
+    if (created) {
+	mem_shared->magic = MEM_SHARED_MAGIC;
+	mem_shared->brk = 0;
+	mem_shared->peak = 0;
+    }
+    if (init_lock)
+	__atomic_store_n(&mem_shared->ready, 1, __ATOMIC_RELEASE);
+    else
+	while (!__atomic_load_n(&mem_shared->ready, __ATOMIC_ACQUIRE))
+	    usleep(1000);
+
+    if (mem_shared->magic != MEM_SHARED_MAGIC) {
+	munmap(p, size);
+	mem_shared = NULL;
+	return -1;
+    }
+    mem_start_brk = (char *)p + MEM_SHARED_HDR;
+    mem_max_addr = mem_start_brk + MAX_HEAP;
+    BRK_LOAD();
+    return 0;
+}
+
+/*
+ * mem_init_shared - initialize the memory system model in the named
+ *    shared-memory segment, creating it if it does not exist yet.
+ *    Returns 1 if this process created the segment, 0 if it attached
+ *    to an existing one, and -1 on error. The mapping address differs
+ *    between processes, so anything stored in the heap must be an
+ *    offset from mem_heap_lo().
+ */
+int mem_init_shared(const char *name)
+{
+    size_t size = MEM_SHARED_HDR + MAX_HEAP;
+    int fd;
+    struct stat st;
+
+    if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) >= 0) {
+	if (ftruncate(fd, size) < 0) {
+	    close(fd);
+	    shm_unlink(name);
+	    return -1;
+	}
+	return mem_map(fd, 1, 1) < 0 ? -1 : 1;
+    }
+    if (errno != EEXIST || (fd = shm_open(name, O_RDWR, 0600)) < 0)
+	return -1;
+    do { /* wait for the creator to size the segment */
+	if (fstat(fd, &st) < 0) {
+	    close(fd);
+	    return -1;
+	}
+    } while ((size_t)st.st_size < size && usleep(1000) == 0);
+    return mem_map(fd, 0, 0) < 0 ? -1 : 0;
+}
+
+/*
+ * mem_init_file - initialize the memory system model in a
+ *    memory-mapped file, so the heap outlives the process. An existing
+ *    file is reopened with its heap intact (its brk is kept in the
+ *    header). Only one process may use the file at a time; its lock is
+ *    reinitialized on every open, since a crashed owner may have left
+ *    it held. Returns 1 if the file was created, 0 if an existing heap
+ *    was reopened, and -1 on error.
+ */
+int mem_init_file(const char *path)
+{
+    size_t size = MEM_SHARED_HDR + MAX_HEAP;
+    int fd, created;
+    struct stat st;
+
+    if ((fd = open(path, O_RDWR | O_CREAT, 0600)) < 0)
+	return -1;
+    if (fstat(fd, &st) < 0) {
+	close(fd);
+	return -1;
+    }
+    created = (st.st_size == 0);
+    if ((size_t)st.st_size != size && 
+	(!created || ftruncate(fd, size) < 0)) { /* not one of our heaps */
+	close(fd);
+	return -1;
+    }
+    return mem_map(fd, created, 1) < 0 ? -1 : created;
+}
+
+/*
+ * mem_sync - flush a file-backed heap to disk (no-op otherwise)
+ */
+void mem_sync(void)
+{
+    if (mem_shared) {
+	BRK_LOAD();
+	msync(mem_shared, MEM_SHARED_HDR + (mem_brk - mem_start_brk), MS_SYNC);
+    }
+}
+
+/*
+ * mem_unlink_shared - remove the name of a shared-memory segment. The
+ *    memory stays valid until every process has unmapped it.
+ */
+int mem_unlink_shared(const char *name)
+{
+    return shm_unlink(name);
+}
+
+/*
+ * mem_shared_area - MEM_SHARED_AREA bytes in the segment header where
+ *    the allocator keeps its roots, or NULL if not in shared mode.
+ */
+void *mem_shared_area(void)
+{
+    return mem_shared ? mem_shared->area : NULL;
+}
+
+/*
+ * mem_shared_lock/mem_shared_unlock - the process-shared lock that
+ *    serializes allocator calls across processes (no-op if not shared)
+ */
+void mem_shared_lock(void)
+{
+    if (mem_shared)
+	pthread_mutex_lock(&mem_shared->lock);
+}
+
+void mem_shared_unlock(void)
+{
+    if (mem_shared)
+	pthread_mutex_unlock(&mem_shared->lock);
 }
 
 /* 
@@ -39,32 +229,53 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    if (mem_shared) {
+	munmap(mem_shared, MEM_SHARED_HDR + MAX_HEAP);
+	mem_shared = NULL;
+    }
+    else
+	free(mem_start_brk);
 }
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_reset_brk - reset the simulated brk pointer to make an empty heap.
+ *    In shared mode this takes the allocator's lock, so that it never
+ *    lands in the middle of another process's allocator call.
  */
 void mem_reset_brk()
 {
+    mem_shared_lock();
     mem_brk = mem_start_brk;
+    mem_peak_brk = mem_start_brk;
+    BRK_STORE();
+    mem_shared_unlock();
 }
 
 /* 
  * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area. A
+ *    negative incr shrinks the heap, but never below its first byte.
  */
 void *mem_sbrk(int incr) 
 {
-    char *old_brk = mem_brk;
+    char *old_brk;
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    BRK_LOAD();
+    old_brk = mem_brk;
+    if ((mem_brk + incr) > mem_max_addr) {
         errno = ENOMEM;
         fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
         return (void *)-1;
     }
+    if ((mem_brk + incr) < mem_start_brk) {
+        errno = EINVAL;
+        fprintf(stderr, "ERROR: mem_sbrk failed. Shrunk below the heap start...\n");
+        return (void *)-1;
+    }
     mem_brk += incr;
+    if (mem_brk > mem_peak_brk)
+        mem_peak_brk = mem_brk;
+    BRK_STORE();
     return (void *)old_brk;
 }
 
@@ -81,6 +292,7 @@ void *mem_heap_lo()
  */
 void *mem_heap_hi()
 {
+    BRK_LOAD();
     return (void *)(mem_brk - 1);
 }
 
@@ -89,9 +301,20 @@ void *mem_heap_hi()
  */
 size_t mem_heapsize() 
 {
+    BRK_LOAD();
     return (size_t)(mem_brk - mem_start_brk);
 }
 
+/*
+ * mem_heap_peak() - returns the largest heap size in bytes since the
+ *    last reset. Equal to mem_heapsize() unless the heap was shrunk.
+ */
+size_t mem_heap_peak() 
+{
+    BRK_LOAD();
+    return (size_t)(mem_peak_brk - mem_start_brk);
+}
+
 /*
  * mem_pagesize() - returns the page size of the system
  */
@@ -2,10 +2,22 @@
 
 void mem_init(void);               
 void mem_deinit(void);
+
+/* Heap in a named shared-memory segment or a file, for use across
+   processes or across restarts */
+#define MEM_SHARED_AREA 3072  /* bytes of allocator roots in the segment */
+int mem_init_shared(const char *name);
+int mem_unlink_shared(const char *name);
+int mem_init_file(const char *path);
+void mem_sync(void);
+void *mem_shared_area(void);
+void mem_shared_lock(void);
+void mem_shared_unlock(void);
 void *mem_sbrk(int incr);
 void mem_reset_brk(void); 
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
+size_t mem_heap_peak(void);
 size_t mem_pagesize(void);
 
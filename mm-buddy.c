@@ -0,0 +1,348 @@
+/**
+ * mm-buddy.c: Binary buddy allocator. mm.c 대신 링크해서 (make MM=mm-buddy 또는
+ *             make mdriver-buddy) 같은 트레이스로 비교하기 위한 엔진.
+ *
+ * - 블록 크기는 항상 2^order 바이트 (MIN_ORDER ~ MAX_ORDER)
+ * - 블록 맨 앞 HDR_SIZE 바이트가 헤더. order만 기록하고, footer는 없음
+ * - 블록 주소는 힙 시작(base)으로부터의 오프셋이 자기 크기의 배수.
+ *   그래서 order k 블록의 buddy는 오프셋 ^ 2^k 에 있고, 병합할 때 힙을 걸을 필요가 없음
+ * - free_lists[k]: order k의 free 블록들 (payload 자리에 pred/succ를 두는 이중 연결 리스트)
+ * - free_map: MIN 블록 단위 비트맵. "여기서 free 블록이 시작함"이면 1.
+ *   buddy가 free인지는 비트 하나 + 그 헤더의 order로 판단
+ * - 힙은 필요한 만큼만 늘림. 힙 끝 오프셋이 2^k의 배수가 아니면, 배수가 될 때까지
+ *   작은 free 블록들을 먼저 붙이고 나서 order k 블록을 붙임
+ * - split / merge는 둘 다 O(log n)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+
+team_t team = {
+    /* Team name */
+    "Gabu-chan and her datenshis",
+    /* First member's full name */
+    "Tenma Gabriel White",
+    /* First member's email address */
+    "tenmwhite@cs.stonybrook.edu",
+    /* Second member's full name (leave blank if none) */
+    "",
+    /* Second member's email address (leave blank if none) */
+    ""
+};
+
+/* 기본 상수, 매크로 */
+#define HDR_SIZE 8                                   // 헤더 크기. payload가 8바이트 정렬되도록 32비트에서도 8B
+#define MIN_ORDER (sizeof(void *) == 8 ? 5 : 4)      // 최소 블록: 헤더 + pred + succ가 들어가야 함 (64비트 32B, 32비트 16B)
+#define MAX_ORDER 24                                 // 최대 블록 16MB (MAX_HEAP 20MB 안쪽)
+#define MAP_BITS (MAX_HEAP >> 4)                     // free_map 비트 수 (MIN 블록이 가장 작은 16B 기준)
+
+#define BLK_SIZE(k) ((size_t)1 << (k))
+#define OFFSET(blk) ((size_t)((char *)(blk) - base))
+#define BLOCK(off)  (base + (off))
+
+#define GET_ORDER(blk)      (*(size_t *)(blk))
+#define SET_ORDER(blk, k)   (*(size_t *)(blk) = (k))
+#define PAYLOAD(blk)        ((char *)(blk) + HDR_SIZE)
+#define BLOCK_OF(bp)        ((char *)(bp) - HDR_SIZE)
+
+/* free 블록의 payload 자리에 두는 리스트 포인터 */
+#define GET_PRED(blk)    (*(void **)PAYLOAD(blk))
+#define GET_SUCC(blk)    (*(void **)(PAYLOAD(blk) + sizeof(void *)))
+#define SET_PRED(blk, p) (GET_PRED(blk) = (p))
+#define SET_SUCC(blk, q) (GET_SUCC(blk) = (q))
+
+/* free_map 비트 조작 */
+#define MAP_IDX(off)   ((off) >> MIN_ORDER)
+#define MAP_TEST(off)  (free_map[MAP_IDX(off) >> 3] & (1 << (MAP_IDX(off) & 7)))
+#define MAP_SET(off)   (free_map[MAP_IDX(off) >> 3] |= (1 << (MAP_IDX(off) & 7)))
+#define MAP_CLEAR(off) (free_map[MAP_IDX(off) >> 3] &= ~(1 << (MAP_IDX(off) & 7)))
+
+
+/* 전역 변수 */
+static char *base = NULL;                  // 힙 시작. 모든 오프셋의 기준
+static size_t heap_end = 0;                // 힙 끝 오프셋 (= 지금까지 sbrk한 양)
+static void *free_lists[MAX_ORDER + 1];    // order별 free 리스트
+static unsigned char free_map[MAP_BITS / 8 + 1];
+
+
+/**
+ * order_of: 헤더 포함 need 바이트가 들어가는 가장 작은 order
+ */
+static inline int order_of(size_t need) {
+    int k = MIN_ORDER;
+
+    while (BLK_SIZE(k) < need)
+        k++;
+    return k;
+}
+
+/**
+ * push_free / pop_free: order k 리스트에 LIFO 삽입 / 임의 위치 제거. 비트맵도 같이 갱신
+ */
+static void push_free(char *blk, int k) {
+    SET_ORDER(blk, k);
+    SET_PRED(blk, NULL);
+    SET_SUCC(blk, free_lists[k]);
+    if (free_lists[k] != NULL)
+        SET_PRED(free_lists[k], blk);
+    free_lists[k] = blk;
+    MAP_SET(OFFSET(blk));
+}
+
+static void pop_free(char *blk, int k) {
+    void *pred = GET_PRED(blk);
+    void *succ = GET_SUCC(blk);
+
+    if (pred != NULL)
+        SET_SUCC(pred, succ);
+    else
+        free_lists[k] = succ;
+    if (succ != NULL)
+        SET_PRED(succ, pred);
+    MAP_CLEAR(OFFSET(blk));
+}
+
+/**
+ * release: order k 블록 blk를 free로 만들고, buddy가 free인 동안 계속 병합
+ */
+static void release(char *blk, int k) {
+    size_t off = OFFSET(blk);
+
+    while (k < MAX_ORDER) {
+        size_t buddy = off ^ BLK_SIZE(k);
+
+        /* buddy가 힙 밖이거나, free가 아니거나, 더 잘게 쪼개져 있으면 멈춤 */
+        if (buddy + BLK_SIZE(k) > heap_end || !MAP_TEST(buddy) || GET_ORDER(BLOCK(buddy)) != (size_t)k)
+            break;
+        pop_free(BLOCK(buddy), k);
+        off &= ~BLK_SIZE(k); // 둘 중 낮은 주소가 합친 블록의 시작
+        k++;
+    }
+    push_free(BLOCK(off), k);
+}
+
+/**
+ * grow: order k 블록을 하나 얻을 수 있도록 힙 끝에 블록을 붙임
+ * - 힙 끝 오프셋이 2^k의 배수가 될 때까지 (끝 오프셋의 최하위 비트 크기) 블록으로 먼저 채움
+ */
+static int grow(int k) {
+    while (heap_end & (BLK_SIZE(k) - 1)) {
+        int filler = __builtin_ctzl(heap_end);
+        if (mem_sbrk(BLK_SIZE(filler)) == (void *)-1)
+            return -1;
+        heap_end += BLK_SIZE(filler);
+        release(BLOCK(heap_end - BLK_SIZE(filler)), filler);
+    }
+    if (mem_sbrk(BLK_SIZE(k)) == (void *)-1)
+        return -1;
+    heap_end += BLK_SIZE(k);
+    release(BLOCK(heap_end - BLK_SIZE(k)), k);
+    return 0;
+}
+
+/**
+ * take: order k 블록을 하나 꺼냄. 큰 블록밖에 없으면 반씩 쪼개고 윗 절반은 free 리스트로
+ */
+static char *take(int k) {
+    int j;
+    char *blk;
+
+    for (j = k; j <= MAX_ORDER && free_lists[j] == NULL; j++)
+        ;
+    if (j > MAX_ORDER) {
+        if (grow(k) < 0)
+            return NULL;
+        for (j = k; free_lists[j] == NULL; j++)
+            ;
+    }
+
+    blk = free_lists[j];
+    pop_free(blk, j);
+    while (j > k) {
+        j--;
+        push_free(blk + BLK_SIZE(j), j);
+    }
+    SET_ORDER(blk, k);
+    return blk;
+}
+
+/* 메모리 관리자 초기화 */
+int mm_init(void) {
+    base = mem_heap_lo();
+    heap_end = mem_heapsize(); // mdriver가 brk를 되돌린 직후라 보통 0
+    memset(free_lists, 0, sizeof(free_lists));
+    memset(free_map, 0, sizeof(free_map));
+    return 0;
+}
+
+void *mm_malloc(size_t size) {
+    int k;
+    char *blk;
+
+    if (size == 0)
+        return NULL;
+    if ((k = order_of(size + HDR_SIZE)) > MAX_ORDER)
+        return NULL;
+    if ((blk = take(k)) == NULL)
+        return NULL;
+    return PAYLOAD(blk);
+}
+
+void mm_free(void *bp) {
+    char *blk;
+
+    if (bp == NULL)
+        return;
+    blk = BLOCK_OF(bp);
+    release(blk, (int)GET_ORDER(blk));
+}
+
+/**
+ * mm_realloc: 지금 블록에 들어가면 그대로, 윗 buddy들이 free면 제자리에서 합쳐 키우고,
+ *             아니면 새로 할당해서 복사
+ */
+void *mm_realloc(void *ptr, size_t size) {
+    char *blk, *newptr;
+    int k, want;
+    size_t off;
+
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+
+    blk = BLOCK_OF(ptr);
+    k = (int)GET_ORDER(blk);
+    if ((want = order_of(size + HDR_SIZE)) > MAX_ORDER)
+        return NULL;
+    if (want <= k)
+        return ptr;
+
+    /* 제자리 확장: blk가 매 단계 아래쪽 절반이고, 위쪽 buddy가 같은 order의 free 블록이어야 함 */
+    off = OFFSET(blk);
+    for (int j = k; j < want; j++) {
+        size_t buddy = off ^ BLK_SIZE(j);
+        if ((off & BLK_SIZE(j)) || buddy + BLK_SIZE(j) > heap_end ||
+            !MAP_TEST(buddy) || GET_ORDER(BLOCK(buddy)) != (size_t)j)
+            break;
+        if (j + 1 == want) { // 끝까지 확인됐으니 이제 실제로 합침
+            for (j = k; j < want; j++)
+                pop_free(BLOCK(off ^ BLK_SIZE(j)), j);
+            SET_ORDER(blk, want);
+            return ptr;
+        }
+    }
+
+    if ((newptr = mm_malloc(size)) == NULL)
+        return NULL;
+    memcpy(newptr, ptr, BLK_SIZE(k) - HDR_SIZE);
+    mm_free(ptr);
+    return newptr;
+}
+
+/*
+ * 아래는 mm.h의 mm.c 전용 조절 API. buddy 엔진에는 해당하는 정책이 없으므로
+ * 설정은 거부하고 통계는 0으로, mm_halloc과 mm_set_root는 실패로 돌려줌
+ */
+int mm_set_fit_policy(mm_fit_policy_t policy) {
+    (void)policy;
+    return -1;
+}
+
+int mm_set_place_policy(mm_place_policy_t policy) {
+    (void)policy;
+    return -1;
+}
+
+int mm_set_fit_profile(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_fit_stats(mm_fit_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+void mm_stats(struct mm_stats *st) {
+    memset(st, 0, sizeof(*st));
+    st->heap_size = mem_heapsize();
+}
+
+int mm_set_phase_profile(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_phase_stats(mm_phase_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+int mm_set_heap_sampling(size_t bytes) {
+    return bytes ? -1 : 0;
+}
+
+int mm_heap_profile(FILE *fp) {
+    (void)fp;
+    return -1;
+}
+
+int mm_set_nursery(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_lifetime_stats(mm_lifetime_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+int mm_set_deferred_free(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_deferred_stats(mm_deferred_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+mm_handle_t mm_halloc(size_t size) {
+    (void)size;
+    return 0;
+}
+
+void mm_hfree(mm_handle_t h) {
+    (void)h;
+}
+
+void *mm_hlock(mm_handle_t h) {
+    (void)h;
+    return NULL;
+}
+
+void mm_hunlock(mm_handle_t h) {
+    (void)h;
+}
+
+size_t mm_compact(size_t budget) {
+    (void)budget;
+    return 0;
+}
+
+void mm_shutdown(void) {
+    mem_sync();
+}
+
+int mm_was_recovered(void) {
+    return 0;
+}
+
+int mm_set_root(void *p) {
+    (void)p;
+    return -1;
+}
+
+void *mm_root(void) {
+    return NULL;
+}
@@ -0,0 +1,574 @@
+/**
+ * mm-cfg.c: 컴파일 타임 설정으로 골라 쓰는 segregated free list 엔진.
+ *           mm-cg45.c, mm-ds2.c, mm.c.bestscore, mm.c.exp-first, mm.c_stash처럼 매크로를
+ *           복사해 가며 갈라진 변형들을 이 파일 하나 + -D 플래그로 대신함.
+ *           (make MM=mm-cfg로 mdriver에 링크하거나, make variants / make rank로 매트릭스 전체 비교)
+ *
+ * 설정 (-D로 넘김. 모두 상수라 핫 패스의 분기는 컴파일러가 접어 버림)
+ * - CFG_WSIZE     4 | 8   헤더/푸터/리스트 링크 워드 크기. 링크는 힙 시작 기준 오프셋이라 포인터 크기와 무관
+ * - CFG_FOOTER    1 | 0   1: 모든 블록에 footer. 0: free 블록에만 footer, 헤더의 PREV_ALLOC 비트로 앞 블록 상태 확인
+ * - CFG_CLASSES   n       크기 클래스 수. 1이면 explicit free list 하나
+ * - CFG_CLASS_MIN 2^k     첫 클래스의 상한. 클래스 i는 CFG_CLASS_MIN << i 이하, 마지막 클래스는 나머지 전부
+ * - CFG_FIT       CFG_FIT_FIRST | CFG_FIT_BEST | CFG_FIT_GOOD (처음 CFG_GOOD_CANDS개 후보 중 최소)
+ * - CFG_REALLOC   0 | 1   0: 항상 새로 할당 & 복사. 1: 제자리 축소/확장 (다음 free 블록, 힙 끝)
+ *
+ * 블록 형식: [헤더][payload ...][푸터(CFG_FOOTER이거나 free일 때)]
+ * free 블록 payload: [pred 오프셋][succ 오프셋]. 오프셋 0은 NULL (힙 맨 앞 패딩 워드라 블록이 올 수 없음)
+ * 배치는 앞쪽에서 자르고, free list는 LIFO, free는 즉시 coalesce
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+
+team_t team = {
+    /* Team name */
+    "Gabu-chan and her datenshis",
+    /* First member's full name */
+    "Tenma Gabriel White",
+    /* First member's email address */
+    "tenmwhite@cs.stonybrook.edu",
+    /* Second member's full name (leave blank if none) */
+    "",
+    /* Second member's email address (leave blank if none) */
+    ""
+};
+
+/* 설정 기본값: mm.c.bestscore에 가까운 조합 */
+#define CFG_FIT_FIRST 0
+#define CFG_FIT_BEST  1
+#define CFG_FIT_GOOD  2
+
+#ifndef CFG_WSIZE
+#define CFG_WSIZE 4
+#endif
+#ifndef CFG_FOOTER
+#define CFG_FOOTER 1
+#endif
+#ifndef CFG_CLASSES
+#define CFG_CLASSES 8
+#endif
+#ifndef CFG_CLASS_MIN
+#define CFG_CLASS_MIN 32
+#endif
+#ifndef CFG_FIT
+#define CFG_FIT CFG_FIT_BEST
+#endif
+#ifndef CFG_GOOD_CANDS
+#define CFG_GOOD_CANDS 8
+#endif
+#ifndef CFG_REALLOC
+#define CFG_REALLOC 1
+#endif
+
+#if CFG_WSIZE == 4
+#define WTYPE uint32_t
+#elif CFG_WSIZE == 8
+#define WTYPE uint64_t
+#else
+#error "CFG_WSIZE must be 4 or 8"
+#endif
+#if CFG_CLASSES < 1 || (CFG_CLASS_MIN & (CFG_CLASS_MIN - 1))
+#error "CFG_CLASSES must be >= 1 and CFG_CLASS_MIN a power of two"
+#endif
+
+/* 기본 상수, 매크로 */
+#define WSIZE CFG_WSIZE
+#define DSIZE (2 * WSIZE)
+#define BALIGN 8                                   // payload 정렬 (config.h의 ALIGNMENT)
+#define CHUNKSIZE (1 << 12)
+#define MIN_BLOCK_SIZE ((4 * WSIZE + BALIGN - 1) & ~(BALIGN - 1)) // 헤더 + pred + succ + 푸터
+#define OVERHEAD (CFG_FOOTER ? DSIZE : WSIZE)      // 할당 블록의 헤더(+푸터)
+
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define BROUND(size) (((size) + (BALIGN - 1)) & ~(size_t)(BALIGN - 1))
+
+#define PREV_ALLOC_BIT 0x2                         // CFG_FOOTER가 0일 때만 씀
+#define PACK(size, prev, alloc) ((size) | (CFG_FOOTER ? 0 : (prev) ? PREV_ALLOC_BIT : 0) | (alloc))
+#define GET(p) (*(WTYPE *)(p))
+#define PUT(p, val) (*(WTYPE *)(p) = (WTYPE)(val))
+#define GET_SIZE(p) ((size_t)(GET(p) & ~(WTYPE)0x7))
+#define GET_ALLOC(p) ((int)(GET(p) & 0x1))
+#define GET_PREV_ALLOC(p) ((int)((GET(p) & PREV_ALLOC_BIT) != 0))
+
+#define HDRP(bp) ((char *)(bp) - WSIZE)
+#define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
+#define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)))
+#define PREV_BLKP(bp) ((char *)(bp) - GET_SIZE((char *)(bp) - DSIZE)) // 앞 블록이 footer를 가질 때만
+
+/* 앞 블록이 할당 상태인지. footer가 없는 설정은 헤더 비트로 */
+#define PREV_IS_ALLOC(bp) (CFG_FOOTER ? GET_ALLOC((char *)(bp) - DSIZE) : GET_PREV_ALLOC(HDRP(bp)))
+
+/* free 블록의 리스트 링크. 힙 시작 기준 오프셋 */
+#define TO_OFF(p)   ((p) ? (WTYPE)((char *)(p) - heap_base) : 0)
+#define FROM_OFF(o) ((o) ? (void *)(heap_base + (o)) : NULL)
+#define GET_PRED(bp) FROM_OFF(GET(bp))
+#define GET_SUCC(bp) FROM_OFF(GET((char *)(bp) + WSIZE))
+#define SET_PRED(bp, p) PUT(bp, TO_OFF(p))
+#define SET_SUCC(bp, q) PUT((char *)(bp) + WSIZE, TO_OFF(q))
+
+/* DEBUG 플래그 옵션 - `Makefile`의 `-DDEBUG` */
+#ifdef DEBUG
+    static void mm_checkheap(int line);
+    #define CHKHEAP(line) (mm_checkheap(line))
+#else
+    #define CHKHEAP(line)
+#endif
+
+
+/* 전역 변수 */
+static char *heap_base = NULL;          // 힙 시작 (mem_heap_lo). 오프셋의 기준
+static char *heap_listp = NULL;         // 프롤로그 블록
+static void *class_head[CFG_CLASSES];   // 클래스별 free list 머리
+
+
+/**
+ * size_class: 블록 크기의 클래스. ceil(log2(size)) - log2(CFG_CLASS_MIN)을 0 ~ CFG_CLASSES-1로 자름
+ */
+static inline int size_class(size_t size) {
+    int c;
+
+    if (CFG_CLASSES == 1)
+        return 0;
+    c = (int)(sizeof(unsigned long) * 8) - __builtin_clzl((unsigned long)(size - 1))
+        - __builtin_ctz(CFG_CLASS_MIN);
+    return c < 0 ? 0 : c > CFG_CLASSES - 1 ? CFG_CLASSES - 1 : c;
+}
+
+/**
+ * adjust_block: 요청 크기를 블록 크기로 (오버헤드 포함, 정렬, 최소 크기)
+ */
+static inline size_t adjust_block(size_t size) {
+    size_t asize = BROUND(size + OVERHEAD);
+    return asize < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : asize;
+}
+
+/**
+ * set_block: bp의 헤더(와 필요하면 푸터) 쓰기. 앞 블록 비트는 헤더에 있던 값을 유지
+ */
+static inline void set_block(void *bp, size_t size, int alloc) {
+    int prev = CFG_FOOTER ? 1 : GET_PREV_ALLOC(HDRP(bp));
+
+    PUT(HDRP(bp), PACK(size, prev, alloc));
+    if (CFG_FOOTER || !alloc)
+        PUT(FTRP(bp), PACK(size, prev, alloc));
+}
+
+/**
+ * set_prev_alloc: 다음 블록 헤더의 PREV_ALLOC 비트 갱신. footer가 있는 설정에서는 아무것도 안 함
+ */
+static inline void set_prev_alloc(void *bp, int alloc) {
+    if (CFG_FOOTER)
+        return;
+    if (alloc)
+        PUT(HDRP(bp), GET(HDRP(bp)) | PREV_ALLOC_BIT);
+    else
+        PUT(HDRP(bp), GET(HDRP(bp)) & ~(WTYPE)PREV_ALLOC_BIT);
+}
+
+/**
+ * insert_node: 클래스 리스트 머리에 LIFO로 삽입
+ */
+static void insert_node(void *bp) {
+    int c = size_class(GET_SIZE(HDRP(bp)));
+
+    SET_PRED(bp, NULL);
+    SET_SUCC(bp, class_head[c]);
+    if (class_head[c] != NULL)
+        SET_PRED(class_head[c], bp);
+    class_head[c] = bp;
+}
+
+/**
+ * remove_node: 클래스 리스트에서 제거
+ */
+static void remove_node(void *bp) {
+    void *pred = GET_PRED(bp), *succ = GET_SUCC(bp);
+
+    if (pred != NULL)
+        SET_SUCC(pred, succ);
+    else
+        class_head[size_class(GET_SIZE(HDRP(bp)))] = succ;
+    if (succ != NULL)
+        SET_PRED(succ, pred);
+}
+
+/**
+ * coalesce: 인접 free 블록과 병합하고 리스트에 넣음. 병합된 블록을 반환
+ */
+static void *coalesce(void *bp) {
+    int prev_alloc = PREV_IS_ALLOC(bp);
+    int next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+    size_t size = GET_SIZE(HDRP(bp));
+
+    if (!next_alloc) {
+        remove_node(NEXT_BLKP(bp));
+        size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
+    }
+    if (!prev_alloc) {
+        bp = PREV_BLKP(bp);
+        remove_node(bp);
+        size += GET_SIZE(HDRP(bp));
+    }
+    set_block(bp, size, 0);
+    set_prev_alloc(NEXT_BLKP(bp), 0);
+    insert_node(bp);
+    return bp;
+}
+
+/**
+ * extend_heap: bytes만큼 힙을 늘려 free 블록으로 만들고 coalesce
+ */
+static void *extend_heap(size_t bytes) {
+    char *bp;
+
+    bytes = BROUND(bytes);
+    if ((bp = mem_sbrk((int)bytes)) == (void *)-1)
+        return NULL;
+    set_block(bp, bytes, 0);                              // 헤더 자리는 옛 에필로그. PREV_ALLOC 비트 유지
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 0, 1));              // 새 에필로그
+    return coalesce(bp);
+}
+
+/**
+ * find_fit: asize의 클래스부터 위로 올라가며 CFG_FIT 정책으로 찾음
+ */
+static void *find_fit(size_t asize) {
+    for (int c = size_class(asize); c < CFG_CLASSES; c++) {
+        void *best = NULL;
+        size_t best_size = (size_t)-1;
+        int cands = 0;
+
+        for (void *bp = class_head[c]; bp != NULL; bp = GET_SUCC(bp)) {
+            size_t bsize = GET_SIZE(HDRP(bp));
+            if (bsize < asize)
+                continue;
+            if (CFG_FIT == CFG_FIT_FIRST || bsize == asize)
+                return bp;
+            if (bsize < best_size) {
+                best = bp;
+                best_size = bsize;
+            }
+            if (CFG_FIT == CFG_FIT_GOOD && ++cands >= CFG_GOOD_CANDS)
+                break;
+        }
+        if (best != NULL) // 위 클래스의 블록은 전부 더 큼
+            return best;
+    }
+    return NULL;
+}
+
+/**
+ * place: free 블록 bp의 앞쪽 asize를 할당. 나머지가 MIN_BLOCK_SIZE 이상이면 free로 분할
+ */
+static void place(void *bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+
+    remove_node(bp);
+    if (csize - asize >= MIN_BLOCK_SIZE) {
+        set_block(bp, asize, 1);
+        void *rest = NEXT_BLKP(bp);
+        PUT(HDRP(rest), PACK(csize - asize, 1, 0));
+        set_block(rest, csize - asize, 0);
+        insert_node(rest); // 뒤는 원래 할당 블록이었으니 병합할 것 없음
+    } else {
+        set_block(bp, csize, 1);
+        set_prev_alloc(NEXT_BLKP(bp), 1);
+    }
+}
+
+/**
+ * split_tail: 할당 블록 bp를 asize로 줄이고, 남는 부분을 free 블록으로 (뒤 free 블록과 병합)
+ */
+static void split_tail(void *bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+
+    if (csize - asize < MIN_BLOCK_SIZE)
+        return;
+    set_block(bp, asize, 1);
+    void *rest = NEXT_BLKP(bp);
+    PUT(HDRP(rest), PACK(csize - asize, 1, 0));
+    coalesce(rest);
+}
+
+/**
+ * tail_free_size: 힙의 마지막 블록이 free면 1과 그 크기. 할당 블록은 footer가 없을 수 있어서 크기를 못 읽음
+ */
+static inline int tail_free_size(size_t *size) {
+    char *epi = (char *)mem_heap_hi() + 1; // 에필로그를 bp로 보는 셈
+    if (PREV_IS_ALLOC(epi))
+        return 0;
+    *size = GET_SIZE(epi - DSIZE);
+    return 1;
+}
+
+
+/* ========================== 공개 함수 =============================== */
+
+int mm_init(void) {
+    char *p;
+
+    for (int c = 0; c < CFG_CLASSES; c++)
+        class_head[c] = NULL;
+    if ((p = mem_sbrk(4 * WSIZE)) == (void *)-1)
+        return -1;
+    heap_base = mem_heap_lo();
+    PUT(p, 0);                                   /* 정렬 패딩 (오프셋 0 = NULL) */
+    PUT(p + (1 * WSIZE), PACK(DSIZE, 1, 1));     /* 프롤로그 헤더 */
+    PUT(p + (2 * WSIZE), PACK(DSIZE, 1, 1));     /* 프롤로그 푸터 */
+    PUT(p + (3 * WSIZE), PACK(0, 1, 1));         /* 에필로그 헤더 */
+    heap_listp = p + (2 * WSIZE);
+
+    if (extend_heap(CHUNKSIZE) == NULL)
+        return -1;
+    CHKHEAP(__LINE__);
+    return 0;
+}
+
+void *mm_malloc(size_t size) {
+    size_t asize, tail;
+    char *bp;
+
+    if (size == 0)
+        return NULL;
+    asize = adjust_block(size);
+
+    if ((bp = find_fit(asize)) == NULL) {
+        /* 꼬리 블록이 free면 부족분만 늘림 (coalesce가 합쳐 줌) */
+        size_t need = tail_free_size(&tail) ? asize - MIN(asize, tail) : MAX(asize, CHUNKSIZE);
+        if ((bp = extend_heap(MAX(need, MIN_BLOCK_SIZE))) == NULL)
+            return NULL;
+    }
+    place(bp, asize);
+    CHKHEAP(__LINE__);
+    return bp;
+}
+
+void mm_free(void *bp) {
+    if (bp == NULL)
+        return;
+    set_block(bp, GET_SIZE(HDRP(bp)), 0);
+    coalesce(bp);
+    CHKHEAP(__LINE__);
+}
+
+void *mm_realloc(void *ptr, size_t size) {
+    size_t oldsize, asize;
+    void *newptr;
+
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+    oldsize = GET_SIZE(HDRP(ptr));
+    asize = adjust_block(size);
+
+    if (CFG_REALLOC) {
+        void *next = NEXT_BLKP(ptr);
+        size_t nsize = GET_SIZE(HDRP(next));
+
+        if (asize <= oldsize) { // 제자리 축소
+            split_tail(ptr, asize);
+            return ptr;
+        }
+        if (!GET_ALLOC(HDRP(next)) && oldsize + nsize >= asize) { // 다음 free 블록 흡수
+            remove_node(next);
+            set_block(ptr, oldsize + nsize, 1);
+            set_prev_alloc(NEXT_BLKP(ptr), 1);
+            split_tail(ptr, asize);
+            return ptr;
+        }
+        if (nsize == 0 || (!GET_ALLOC(HDRP(next)) && GET_SIZE(HDRP(NEXT_BLKP(next))) == 0)) {
+            /* 힙 끝 블록: 부족분만 늘려서 흡수 */
+            size_t avail = oldsize + (GET_ALLOC(HDRP(next)) ? 0 : nsize);
+            void *bp = extend_heap(MAX(asize - avail, MIN_BLOCK_SIZE)); // coalesce가 next(free)도 합쳐 줌
+            if (bp == NULL)
+                return NULL;
+            remove_node(bp);
+            set_block(ptr, oldsize + GET_SIZE(HDRP(bp)), 1);
+            set_prev_alloc(NEXT_BLKP(ptr), 1);
+            split_tail(ptr, asize);
+            return ptr;
+        }
+    }
+
+    if ((newptr = mm_malloc(size)) == NULL)
+        return NULL;
+    memcpy(newptr, ptr, MIN(size, oldsize - OVERHEAD));
+    mm_free(ptr);
+    return newptr;
+}
+
+/*
+ * 아래는 mm.h의 mm.c 전용 조절 API. 이 엔진은 정책을 컴파일 타임에 고르므로
+ * 실행 중 설정은 거부하고 통계는 0으로, mm_halloc과 mm_set_root는 실패로 돌려줌
+ */
+int mm_set_fit_policy(mm_fit_policy_t policy) {
+    (void)policy;
+    return -1;
+}
+
+int mm_set_place_policy(mm_place_policy_t policy) {
+    (void)policy;
+    return -1;
+}
+
+int mm_set_fit_profile(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_fit_stats(mm_fit_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+void mm_stats(struct mm_stats *st) {
+    memset(st, 0, sizeof(*st));
+    st->heap_size = mem_heapsize();
+}
+
+int mm_set_phase_profile(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_phase_stats(mm_phase_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+int mm_set_heap_sampling(size_t bytes) {
+    return bytes ? -1 : 0;
+}
+
+int mm_heap_profile(FILE *fp) {
+    (void)fp;
+    return -1;
+}
+
+int mm_set_nursery(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_lifetime_stats(mm_lifetime_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+int mm_set_deferred_free(int enable) {
+    return enable ? -1 : 0;
+}
+
+void mm_deferred_stats(mm_deferred_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+mm_handle_t mm_halloc(size_t size) {
+    (void)size;
+    return 0;
+}
+
+void mm_hfree(mm_handle_t h) {
+    (void)h;
+}
+
+void *mm_hlock(mm_handle_t h) {
+    (void)h;
+    return NULL;
+}
+
+void mm_hunlock(mm_handle_t h) {
+    (void)h;
+}
+
+size_t mm_compact(size_t budget) {
+    (void)budget;
+    return 0;
+}
+
+void mm_shutdown(void) {
+    mem_sync();
+}
+
+int mm_was_recovered(void) {
+    return 0;
+}
+
+int mm_set_root(void *p) {
+    (void)p;
+    return -1;
+}
+
+void *mm_root(void) {
+    return NULL;
+}
+
+
+/* ========================== Debugging Functions =============================== */
+#ifdef DEBUG
+
+/**
+ * mm_checkheap: 블록 형식, 앞 블록 비트, 병합 누락, 클래스 리스트 일관성 검사
+ */
+static void mm_checkheap(int line) {
+    char *bp;
+    int errors = 0, heap_free = 0, list_free = 0, prev_alloc = 1;
+
+    for (bp = NEXT_BLKP(heap_listp); GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+        size_t size = GET_SIZE(HDRP(bp));
+        int alloc = GET_ALLOC(HDRP(bp));
+
+        if (((uintptr_t)bp % BALIGN) || size < MIN_BLOCK_SIZE) {
+            fprintf(stderr, "❌ [%d] Bad block %p (size %zu)\n", line, bp, size);
+            errors++;
+        }
+        if ((CFG_FOOTER || !alloc) && GET(HDRP(bp)) != GET(FTRP(bp))) {
+            fprintf(stderr, "❌ [%d] Header/footer mismatch at %p\n", line, bp);
+            errors++;
+        }
+        if (!CFG_FOOTER && GET_PREV_ALLOC(HDRP(bp)) != prev_alloc) {
+            fprintf(stderr, "❌ [%d] Stale prev-alloc bit at %p\n", line, bp);
+            errors++;
+        }
+        if (!alloc && !prev_alloc) {
+            fprintf(stderr, "❌ [%d] Two consecutive free blocks before %p\n", line, bp);
+            errors++;
+        }
+        heap_free += !alloc;
+        prev_alloc = alloc;
+    }
+    if (!GET_ALLOC(HDRP(bp)) || (char *)bp - 1 != (char *)mem_heap_hi()) {
+        fprintf(stderr, "❌ [%d] Bad epilogue at %p\n", line, bp);
+        errors++;
+    }
+
+    for (int c = 0; c < CFG_CLASSES; c++) {
+        for (void *f = class_head[c]; f != NULL; f = GET_SUCC(f)) {
+            if (GET_ALLOC(HDRP(f)) || size_class(GET_SIZE(HDRP(f))) != c) {
+                fprintf(stderr, "❌ [%d] Block %p does not belong in class %d\n", line, f, c);
+                errors++;
+            }
+            if (GET_SUCC(f) != NULL && GET_PRED(GET_SUCC(f)) != f) {
+                fprintf(stderr, "❌ [%d] Pred/succ mismatch at %p\n", line, f);
+                errors++;
+            }
+            if (++list_free > heap_free) {
+                fprintf(stderr, "❌ [%d] Free list longer than the free blocks (cycle?)\n", line);
+                errors++;
+                break;
+            }
+        }
+    }
+    if (list_free != heap_free) {
+        fprintf(stderr, "❌ [%d] %d free blocks in the heap, %d in the lists\n", line, heap_free, list_free);
+        errors++;
+    }
+    if (errors)
+        fprintf(stderr, "[mm_checkheap] %d error(s) detected\n", errors);
+}
+
+#endif /* DEBUG */
+/* ========================== End of Debugging Functions =============================== */
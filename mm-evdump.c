@@ -0,0 +1,171 @@
+/**
+ * mm-evdump: -DMM_EVENTS로 빌드한 mm.c가 남긴 이벤트 링 파일(mm-evlog.<pid>.<tid>)을 읽어서 출력.
+ * 정상 종료든 crash든 파일에 남은 그대로 읽음 (링은 MAP_SHARED 파일이라 flush가 필요 없음)
+ *
+ *   mm-evdump [-n N] [-s] 파일...
+ *   -n N: 파일마다 마지막 N개만
+ *   -s  : 레코드 대신 요약 (op별 개수, 평균 탐색 길이, split 비율, coalesce 케이스 분포)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mm-events.h"
+
+static const char *op_name(uint32_t op) {
+    static const char *names[] = {"?", "malloc", "free", "realloc", "fit", "place", "coalesce", "grow"};
+    return op <= MM_EV_GROW ? names[op] : "?";
+}
+
+static void print_record(uint64_t seq, uint64_t t0, const mm_event_t *e) {
+    if (e->tsc)
+        printf("%10llu %12llu", (unsigned long long)seq, (unsigned long long)(e->tsc - t0));
+    else
+        printf("%10llu %12s", (unsigned long long)seq, ""); // 결정 이벤트는 시각 없음
+    printf(" %-8s %8u %#14llx", op_name(e->op), e->size, (unsigned long long)e->block);
+    switch (e->op) {
+    case MM_EV_FIT:
+        printf("  search %u%s", e->search, e->block ? "" : "  (no fit)");
+        break;
+    case MM_EV_PLACE:
+        if (e->outcome)
+            printf("  split %u", e->outcome);
+        break;
+    case MM_EV_COALESCE:
+        printf("  case %u", e->outcome);
+        break;
+    case MM_EV_REALLOC:
+        printf("  %s", e->outcome ? "in place" : "moved");
+        break;
+    }
+    printf("\n");
+}
+
+static void print_summary(const mm_ev_ring_t *r, uint64_t first, uint64_t last) {
+    uint64_t ops[MM_EV_GROW + 1] = {0}, cases[5] = {0};
+    uint64_t fits = 0, misses = 0, search = 0, splits = 0;
+    uint64_t seq;
+
+    for (seq = first; seq < last; seq++) {
+        const mm_event_t *e = &r->rec[seq % r->capacity];
+
+        if (e->op > MM_EV_GROW)
+            continue;
+        ops[e->op]++;
+        if (e->op == MM_EV_FIT) {
+            fits++;
+            search += e->search;
+            misses += (e->block == 0);
+        } else if (e->op == MM_EV_PLACE) {
+            splits += (e->outcome != 0);
+        } else if (e->op == MM_EV_COALESCE && e->outcome >= 1 && e->outcome <= 4) {
+            cases[e->outcome]++;
+        }
+    }
+
+    for (int op = MM_EV_MALLOC; op <= MM_EV_GROW; op++)
+        printf("%-8s %10llu\n", op_name(op), (unsigned long long)ops[op]);
+    if (fits)
+        printf("fit: %.2f nodes/search, %llu misses\n", (double)search / fits, (unsigned long long)misses);
+    if (ops[MM_EV_PLACE])
+        printf("place: %.1f%% split\n", 100.0 * splits / ops[MM_EV_PLACE]);
+    if (ops[MM_EV_COALESCE])
+        printf("coalesce: case1 %llu, case2 %llu, case3 %llu, case4 %llu\n",
+               (unsigned long long)cases[1], (unsigned long long)cases[2],
+               (unsigned long long)cases[3], (unsigned long long)cases[4]);
+}
+
+/**
+ * dump_file: 링 하나를 읽음. 한 바퀴 넘게 돌았으면 head 칸은 쓰다 만 것일 수 있으니
+ * (crash 시점에 덮어쓰던 칸) 가장 오래된 칸 하나는 버림
+ */
+static int dump_file(const char *path, uint64_t tail, int summary) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    mm_ev_ring_t *r;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(mm_ev_ring_t)) {
+        fprintf(stderr, "%s: too short for an event ring\n", path);
+        close(fd);
+        return -1;
+    }
+    r = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    if (r->magic != MM_EV_MAGIC || r->rec_size != sizeof(mm_event_t) || r->capacity == 0
+        || sizeof(mm_ev_ring_t) + r->capacity * sizeof(mm_event_t) > (size_t)st.st_size) {
+        fprintf(stderr, "%s: not an event ring (or written by a different layout)\n", path);
+        munmap(r, st.st_size);
+        return -1;
+    }
+
+    uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > r->capacity ? head - r->capacity + 1 : 0;
+
+    if (tail && head - first > tail)
+        first = head - tail;
+
+    printf("# %s: pid %llu tid %llu, %llu events, showing %llu-%llu\n", path,
+           (unsigned long long)r->pid, (unsigned long long)r->tid, (unsigned long long)head,
+           (unsigned long long)first, (unsigned long long)(head ? head - 1 : 0));
+    if (summary) {
+        print_summary(r, first, head);
+    } else if (head > first) {
+        uint64_t t0 = 0, seq;
+
+        for (seq = first; seq < head && t0 == 0; seq++) // 처음으로 시각이 있는 레코드 기준
+            t0 = r->rec[seq % r->capacity].tsc;
+
+        printf("%10s %12s %-8s %8s %14s\n", "seq", "cycles", "op", "size", "block");
+        for (seq = first; seq < head; seq++)
+            print_record(seq, t0, &r->rec[seq % r->capacity]);
+    }
+    munmap(r, st.st_size);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n N] [-s] file...\n", prog);
+    fprintf(stderr, "\t-n N  Print only the last N events of each ring.\n");
+    fprintf(stderr, "\t-s    Print a summary instead of the events.\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    uint64_t tail = 0;
+    int summary = 0, c, ret = 0;
+
+    while ((c = getopt(argc, argv, "n:s")) != EOF) {
+        switch (c) {
+        case 'n':
+            tail = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            summary = 1;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind >= argc)
+        usage(argv[0]);
+
+    for (; optind < argc; optind++)
+        if (dump_file(argv[optind], tail, summary) < 0)
+            ret = 1;
+    return ret;
+}
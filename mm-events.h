@@ -0,0 +1,50 @@
+/*
+ * Allocator decision log, written by mm.c when built with -DMM_EVENTS
+ * and read back by mm-evdump.
+ *
+ * Every thread that enters the allocator maps its own ring file,
+ * <prefix>.<pid>.<tid>, where the prefix comes from the MM_EVLOG
+ * environment variable (default "mm-evlog"). The thread is the only
+ * writer: it fills the slot at head % MM_EV_RING and then advances head
+ * with a release store, so no locks are taken. The ring is a shared file
+ * mapping, so the records are in the file even when the process dies
+ * without flushing anything; the record at head may be torn in that case.
+ */
+#ifndef MM_EVENTS_H
+#define MM_EVENTS_H
+
+#include <stdint.h>
+
+#define MM_EV_MAGIC 0x6d6d6576u /* "mmev" */
+#define MM_EV_RING  (1 << 16)   /* records per ring (power of two) */
+
+enum {
+    MM_EV_MALLOC = 1, /* size: request, block: result (0 if it failed) */
+    MM_EV_FREE,       /* size: block size, block: the block */
+    MM_EV_REALLOC,    /* size: request, block: result, outcome: 1 if it stayed in place */
+    MM_EV_FIT,        /* size: asize, block: the fit (0 if none), search: nodes visited */
+    MM_EV_PLACE,      /* size: free block taken, block: allocated block, outcome: bytes split off (0 = no split) */
+    MM_EV_COALESCE,   /* size: merged size, block: merged block, outcome: case 1-4 */
+    MM_EV_GROW        /* size: bytes added with sbrk, block: the new free block before coalescing */
+};
+
+typedef struct {
+    uint64_t tsc;      /* cycle counter at malloc/free/realloc; 0 for the decisions in between */
+    uint64_t block;    /* block pointer (bp), 0 if none */
+    uint32_t op;       /* MM_EV_* */
+    uint32_t size;
+    uint32_t search;
+    uint32_t outcome;
+} mm_event_t;          /* 32 bytes, two per cache line */
+
+typedef struct {
+    uint32_t magic;    /* MM_EV_MAGIC */
+    uint32_t rec_size; /* sizeof(mm_event_t) */
+    uint64_t capacity; /* MM_EV_RING */
+    uint64_t head;     /* records ever written; slot head % capacity is next */
+    uint64_t pid, tid;
+    uint64_t pad[3];   /* header fills one cache line */
+    mm_event_t rec[];
+} mm_ev_ring_t;
+
+#endif /* MM_EVENTS_H */
@@ -0,0 +1,142 @@
+/**
+ * mm-pool.c: 고정 크기 객체 풀. 리스트 노드, 해시 엔트리, 타이머처럼 크기가 하나뿐인 구조체용.
+ * - mm_malloc으로 slab을 받아 objsize 단위로 잘라 씀
+ * - 객체에는 헤더가 없음. free 객체의 첫 워드를 다음 free 객체 포인터로 쓰는 intrusive 리스트
+ * - get/put은 포인터 pop/push 하나. 경계 태그도, coalesce도 없음
+ * - slab은 한 번에 다 자르지 않고 bump pointer로 필요할 때만 잘라 감 (안 쓰는 부분은 안 건드림)
+ * - slab은 destroy 때만 힙에 돌아감
+ *
+ * slab 형식: [다음 slab 포인터][align 맞춤 패딩][객체][객체] ...
+ * mm-region.c처럼 mm.h 함수들만 쓰므로 어떤 엔진과도 같이 링크됨
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mm.h"
+#include "config.h"
+
+#define POOL_SLAB (1 << 12)    // slab 하나의 기본 크기
+#define POOL_MIN_OBJS 8        // 객체가 커도 slab 하나에 최소 이만큼은 들어가게 함
+#define ROUNDUP(x, a) (((x) + ((a)-1)) & ~(size_t)((a)-1)) // a(2의 거듭제곱)의 배수로 올림
+
+#define NEXT_FREE(obj) (*(void **)(obj)) // free 객체의 첫 워드: 다음 free 객체
+#define NEXT_SLAB(s) (*(void **)(s))     // slab 첫 워드: 다음 slab
+
+struct mm_pool {
+    size_t objsize;    // align 배수로 올린 객체 크기
+    size_t align;      // 객체 정렬
+    size_t slab_size;  // mm_malloc에 요청하는 slab 크기 (머리, 패딩 포함)
+    void *free_list;   // put으로 돌아온 객체들
+    char *bump;        // 지금 slab에서 아직 안 잘라 준 부분의 시작
+    char *bump_end;    // ... 과 끝
+    void *slabs;       // 받은 slab들의 연결 리스트
+    mm_pool_stats_t st;
+};
+
+/**
+ * mm_pool_create: objsize 바이트, align 정렬 객체의 풀 생성. align은 2의 거듭제곱 (0이면 ALIGNMENT)
+ */
+mm_pool_t *mm_pool_create(size_t objsize, size_t align) {
+    mm_pool_t *p;
+    size_t per_slab;
+
+    if (objsize == 0)
+        return NULL;
+    if (align < ALIGNMENT)
+        align = ALIGNMENT;
+    if (align & (align - 1))
+        return NULL;
+    if ((p = mm_malloc(sizeof(mm_pool_t))) == NULL)
+        return NULL;
+
+    if (objsize < sizeof(void *)) // free 리스트 포인터가 들어가야 함
+        objsize = sizeof(void *);
+    p->objsize = ROUNDUP(objsize, align);
+    p->align = align;
+
+    /* 머리 + 최악의 패딩(align - ALIGNMENT) 뒤에 최소 POOL_MIN_OBJS개 */
+    per_slab = sizeof(void *) + (align - ALIGNMENT) + POOL_MIN_OBJS * p->objsize;
+    p->slab_size = per_slab > POOL_SLAB ? per_slab : POOL_SLAB;
+
+    p->free_list = NULL;
+    p->bump = p->bump_end = NULL;
+    p->slabs = NULL;
+    p->st.objsize = p->objsize;
+    p->st.slabs = 0;
+    p->st.in_use = 0;
+    p->st.high_water = 0;
+    p->st.capacity = 0;
+    return p;
+}
+
+/**
+ * new_slab: slab을 하나 더 받아 bump 구간으로 삼음
+ */
+static int new_slab(mm_pool_t *p) {
+    char *s = mm_malloc(p->slab_size);
+    char *first, *end;
+
+    if (s == NULL)
+        return -1;
+    NEXT_SLAB(s) = p->slabs;
+    p->slabs = s;
+
+    first = (char *)ROUNDUP((uintptr_t)s + sizeof(void *), p->align);
+    end = s + p->slab_size;
+    p->bump = first;
+    p->bump_end = first + (end - first) / p->objsize * p->objsize;
+    p->st.slabs++;
+    p->st.capacity += (p->bump_end - first) / p->objsize;
+    return 0;
+}
+
+/**
+ * mm_pool_get: 객체 하나. free 리스트 pop -> 지금 slab에서 bump -> 새 slab 순서
+ */
+void *mm_pool_get(mm_pool_t *p) {
+    void *obj = p->free_list;
+
+    if (obj != NULL) {
+        p->free_list = NEXT_FREE(obj);
+    } else {
+        if (p->bump == p->bump_end && new_slab(p) < 0)
+            return NULL;
+        obj = p->bump;
+        p->bump += p->objsize;
+    }
+
+    if (++p->st.in_use > p->st.high_water)
+        p->st.high_water = p->st.in_use;
+    return obj;
+}
+
+/**
+ * mm_pool_put: 객체를 풀에 돌려줌 (free 리스트 push). obj는 이 풀에서 get한 것이어야 함
+ */
+void mm_pool_put(mm_pool_t *p, void *obj) {
+    if (obj == NULL || p->st.in_use == 0) // 나간 객체가 없는데 돌아온 건 이 풀 것이 아님. 무시
+        return;
+    NEXT_FREE(obj) = p->free_list;
+    p->free_list = obj;
+    p->st.in_use--;
+}
+
+/**
+ * mm_pool_destroy: 모든 slab과 풀 자신을 힙에 돌려줌. 남아 있는 객체도 같이 사라짐
+ */
+void mm_pool_destroy(mm_pool_t *p) {
+    void *s, *next;
+
+    for (s = p->slabs; s != NULL; s = next) {
+        next = NEXT_SLAB(s);
+        mm_free(s);
+    }
+    mm_free(p);
+}
+
+/**
+ * mm_pool_stats: 사용 중 객체 수, slab 수, high-water mark 등을 st에 복사
+ */
+void mm_pool_stats(mm_pool_t *p, mm_pool_stats_t *st) {
+    *st = p->st;
+}
@@ -0,0 +1,105 @@
+/**
+ * mm-region.c: Region(arena) API. mm_malloc으로 큰 청크를 받아 bump pointer로 잘라 주고,
+ *              reset/destroy 때 청크들을 한꺼번에 돌려줌.
+ * - 객체마다 mm_free(와 그때마다의 coalesce)를 부르지 않고, 요청 처리가 끝나면 reset 한 번
+ * - 객체 개별 해제는 없음. 청크 단위로만 힙에 돌아감
+ * - mm.h의 mm_malloc/mm_free 위에서만 동작하므로 어떤 엔진(mm.c, mm-buddy.c)과도 같이 링크됨
+ *
+ * 청크 형식: [다음 청크 포인터 (정렬 패딩 포함)][객체들 ...]
+ * 첫 청크("home")에는 mm_region 구조체 자신이 들어 있고, reset해도 돌려주지 않음
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mm.h"
+#include "config.h"
+
+#define REGION_CHUNK (1 << 12)           // 청크 하나의 크기
+#define REGION_BIG (REGION_CHUNK / 4)    // 이보다 큰 요청은 자기 전용 청크를 따로 받음
+#define RALIGN(size) (((size) + (ALIGNMENT-1)) & ~(size_t)(ALIGNMENT-1)) // ALIGNMENT의 배수로 올림
+#define CHUNK_HDR RALIGN(sizeof(void *)) // 청크 머리: 다음 청크 포인터
+
+struct mm_region {
+    void *chunks;   // home을 뺀 나머지 청크들의 연결 리스트
+    char *top;      // bump pointer
+    char *end;      // 지금 청크의 끝
+    char *home_top; // home 청크에서 이 구조체 바로 뒤. reset하면 여기서 다시 시작
+    char *home_end; // home 청크의 끝
+};
+
+#define NEXT_CHUNK(c) (*(void **)(c))
+
+/**
+ * new_chunk: size 바이트를 담을 청크를 받아 리스트에 달고, 데이터 시작 주소를 반환
+ */
+static char *new_chunk(mm_region_t *r, size_t size) {
+    char *c = mm_malloc(CHUNK_HDR + size);
+
+    if (c == NULL)
+        return NULL;
+    NEXT_CHUNK(c) = r->chunks;
+    r->chunks = c;
+    return c + CHUNK_HDR;
+}
+
+/**
+ * mm_region_create: 빈 region 생성. 구조체는 첫 청크 맨 앞에 둠
+ */
+mm_region_t *mm_region_create(void) {
+    char *home = mm_malloc(REGION_CHUNK);
+    mm_region_t *r = (mm_region_t *)home;
+
+    if (home == NULL)
+        return NULL;
+    r->chunks = NULL;
+    r->home_top = r->top = home + RALIGN(sizeof(mm_region_t));
+    r->home_end = r->end = home + REGION_CHUNK;
+    return r;
+}
+
+/**
+ * mm_region_alloc: region에서 size 바이트 할당. 지금 청크가 모자라면 새 청크로 넘어감
+ */
+void *mm_region_alloc(mm_region_t *r, size_t size) {
+    char *p;
+
+    if (size == 0)
+        return NULL;
+    size = RALIGN(size);
+
+    if (size > REGION_BIG) // 큰 객체: 전용 청크. bump 중인 청크는 그대로 둠
+        return new_chunk(r, size);
+
+    if (r->top + size > r->end) {
+        if ((p = new_chunk(r, REGION_CHUNK - CHUNK_HDR)) == NULL)
+            return NULL;
+        r->top = p;
+        r->end = p + REGION_CHUNK - CHUNK_HDR;
+    }
+    p = r->top;
+    r->top += size;
+    return p;
+}
+
+/**
+ * mm_region_reset: region의 모든 객체를 한 번에 해제. home 청크만 남기고 청크들을 힙에 돌려줌
+ */
+void mm_region_reset(mm_region_t *r) {
+    void *c, *next;
+
+    for (c = r->chunks; c != NULL; c = next) {
+        next = NEXT_CHUNK(c);
+        mm_free(c);
+    }
+    r->chunks = NULL;
+    r->top = r->home_top;
+    r->end = r->home_end;
+}
+
+/**
+ * mm_region_destroy: reset 후 home 청크(구조체 포함)까지 돌려줌
+ */
+void mm_region_destroy(mm_region_t *r) {
+    mm_region_reset(r);
+    mm_free(r);
+}
@@ -1,16 +1,63 @@
 /**
- * mm.c v0.3: Explicit allocator & explicit free list & next-fit 탐색 기반 & mm_realloc 개선판.
+ * mm.c v0.8: Explicit allocator & explicit free list & 배치 정책 선택 & mm_realloc 개선판.
  * - header/footer로 크기, 할당 비트 관리
  * - free는 coalescing으로 인접 빈 블록을 병합
  * - realloc은 in-place shrink/expand 적용
  * - split으로 남는 공간 분할
+ * - find_fit은 first / next / best / good fit 중 mm_set_fit_policy로 고른 정책을 따름
+ *   (adaptive면 탐색 길이와 단편화를 보고 실행 중에 정책을 바꿈)
+ * - -DMM_SIZE_CACHE 빌드는 블록 크기를 free 노드 안(링크 옆)에도 복사해 두어서, find_fit이 노드 하나에
+ *   캐시 라인 하나만 건드림. -DMM_PREFETCH 빌드는 탐색 중에 다음 노드를 미리 prefetch
+ *   (트레이스 힙은 캐시에 다 들어가서 prefetch는 명령어만 늘어남. 그래서 기본은 끔. mdriver -F로 비교)
+ * - -DMM_SIZE_INDEX 빌드: free 블록을 크기 클래스별 연속 배열(크기, 오프셋)에도 넣고, find_fit은 리스트 대신
+ *   이 배열의 크기들을 훑음. -DMM_SIMD를 더하면 AVX2(-mavx2)는 8칸, SSE4.1(-msse4.1)은 4칸씩 한 번에 비교
+ * - mm_halloc으로 받은 핸들 블록은 움직일 수 있음. mm_compact가 힙 아래쪽으로 밀어 모으고 brk를 줄임
+ * - mm_set_phase_profile: 탐색/분할/coalesce/힙 확장/realloc 복사 단계별 사이클 (mdriver -C)
+ * - mm_stats: 힙 크기, live/free 바이트, 크기 클래스별 free, 외부 단편화, 그리고 항상 켜 둔 카운터
+ *   (extend_heap 호출, find_fit 탐색 길이 히스토그램, coalesce 케이스)
+ * - -DMM_THREADS 빌드: 공개 함수는 힙 락을 잡음. 지연 free 모드에서는 mm_free가 락 없이 큐에 넣고
+ *   백그라운드 스레드가 모아서 coalesce
+ * - -DMM_SHARED 빌드: memlib의 공유 메모리 힙(mem_init_shared)을 여러 프로세스가 같이 씀.
+ *   free list 링크와 루트는 힙 시작 기준 오프셋으로 저장하고, 락은 프로세스 간 공유 mutex
+ *   파일 힙(mem_init_file)이면 재시작 때 그대로 다시 붙고, 정상 종료 표시가 없으면 힙을 검사해서 free list를 다시 만듦
+ * - -DMM_EVENTS 빌드: find_fit/place/coalesce/힙 확장과 공개 함수가 결정 하나마다 32B 레코드를 스레드별 링 파일에 남김.
+ *   mm-evdump로 실행 후(crash 후에도) 읽음. 끄면 훅이 빈 매크로라 비용 없음
+ * - -DMM_USDT 빌드: 공개 함수 진입/반환, extend_heap, coalesce, place의 split에 sys/sdt.h 프로브.
+ *   perf/bpftrace로 바이너리를 안 건드리고 붙임 (프로브 목록과 인자는 PROBE 매크로 위 주석)
+ * - mm_set_heap_sampling: 평균 N 바이트마다 malloc 하나의 스택과 크기를 샘플링, free 때 뺌.
+ *   mm_heap_profile이 live/누적 프로파일을 pprof이 읽는 텍스트 형식으로 씀
  */
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <unistd.h>
 #include <string.h>
+#include <math.h>
+#include <execinfo.h>
+
+#ifdef MM_THREADS
+#include <pthread.h>
+#endif
+
+#ifdef MM_SIMD
+#include <immintrin.h>
+#endif
+
+#ifdef MM_USDT
+#if !__has_include(<sys/sdt.h>)
+#error "MM_USDT needs <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel)"
+#endif
+#include <sys/sdt.h>
+#endif
+
+#ifdef MM_EVENTS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "mm-events.h"
+#endif
 
 #include "mm.h"
 #include "memlib.h"
@@ -34,14 +81,70 @@ team_t team = {
 #define DSIZE (2 * WSIZE)    // 더블 워드 크기
 #define PTR_SIZE (sizeof(void *))  // 포인터 크기
 
+#if defined(MM_SIZE_CACHE) || defined(MM_SIZE_INDEX)
+#define MIN_BLOCK_SIZE  (((2*WSIZE) + 3*PTR_SIZE + 0x7) & ~0x7) // 링크 + 크기 사본/인덱스 위치. 64비트면 아래와 같은 40B
+#else
 #define MIN_BLOCK_SIZE  (((2*WSIZE) + 2*PTR_SIZE + (DSIZE-1)) & ~0x7) // 이식성 최대로!
+#endif
 // #define MIN_BLOCK_SIZE 24   // explicit free list일 때 블록의 최소 사이즈 - header(4B) + prev(4B) + next(4B) + footer(4B) = 16B. 64비트 아키텍처면 header(4B) + prev(8B) + next(8B) + footer(4B) = 24B.
 // #define MIN_BLOCK_SIZE 16   // 블록의 최소 사이즈 - 즉 2*DSIZE
 #define ALIGNMENT DSIZE        // Payload Alignment - 위 MIN_BLOCK_SIZE는 이 숫자의 배수여야 함.
+#define DRIVER_ALIGN 8         // config.h의 ALIGNMENT. mdriver가 payload에 요구하는 정렬이고 힙 검사도 이걸로 함 (64비트는 MIN_BLOCK_SIZE 40이라 DSIZE 정렬까진 안 됨)
 #define BYTE char           // Byte type
-#define CHUNKSIZE (1 << 12) // 청크 크기
+#define CHUNKSIZE (1 << 12) // 청크 크기 (초기 힙 & 힙 확장 청크의 최솟값)
 #define MAX_HEAP_BLOCKS (1 << 12) // mm_heapcheck에서, 힙 블록 무한루프 감지용. MIN_BLOCK_SIZE랑은 상관 없는 개념이며 단위도 다름. 위는 bytes, 이건 2^12 blocks.
 
+/* 배치 정책 관련 상수 */
+#define GOOD_FIT_CANDIDATES 8   // good fit: 처음 찾은 후보 몇 개 중에서 가장 작은 블록을 고를지
+#define ADAPT_WINDOW 256        // adaptive: 몇 번의 find_fit마다 정책을 다시 고를지
+#define ADAPT_SEARCH_LONG 32    // adaptive: 윈도우 평균 탐색 길이(노드 수)가 이보다 길면 "탐색이 비쌈"
+#define ADAPT_FRAG_HIGH 250     // adaptive: free 바이트 / 힙 크기(천분율)가 이보다 크면 "단편화 심함"
+#define PLACE_LARGE_MIN 128     // two-ended 배치에서 이 크기(asize) 이상이면 "큰 요청"으로 보고 뒤쪽에서 잘라냄
+
+/* 힙 확장(growth engine) 관련 상수 */
+#define GROW_CHUNK_MAX (1 << 16) // 한 번에 늘리는 청크의 상한
+#define GROW_HEAP_SHIFT 4        // 청크는 현재 힙 크기의 1/2^GROW_HEAP_SHIFT도 넘지 않게 (끝에 남는 slack 제한)
+#define GROW_FAST 16             // 직전 확장 이후 malloc이 이 횟수 미만이면 확장이 잦은 것 → 청크 2배
+#define GROW_SLOW 256            // 이 횟수를 넘기면 확장이 뜸한 것 → 청크 절반
+
+/* 수명 예측 & nursery 관련 상수 */
+#define NURSERY_BIT 0x2              // nursery 객체 헤더 표시. 일반 블록 헤더에서는 항상 0
+#define NURSERY_SIZE (1 << 13)       // nursery 영역 크기 (힙에서 블록 하나로 떼어 옴)
+#define NURSERY_MAX_OBJ 512          // 이 크기(asize)를 넘는 요청은 예측하지 않고 바로 힙으로
+#define LIFE_BUCKETS (NURSERY_MAX_OBJ / 8 + 1) // 크기 이력 테이블 칸 수 (8바이트 단위)
+#define LIFE_SHORT 64                // 할당 후 이 횟수 이내의 malloc/free 안에 죽으면 "단명"
+#define LIFE_TRACK 4096              // 힙 블록의 수명을 재기 위한 표본 테이블 크기 (2의 거듭제곱)
+
+/* 핸들 & compaction 관련 상수 */
+#define MOVABLE_BIT 0x4              // 핸들 블록(움직일 수 있는 블록) 헤더 표시. 푸터에는 안 씀
+#define HSLOT_INIT 64                // 첫 슬롯 테이블의 슬롯 수. 모자라면 2배 블록으로 옮김
+#define COMPACT_LOOKAHEAD 32         // 당길 수 없는 free 블록을 만나면 뒤로 몇 블록까지 채울 핸들 블록을 찾아볼지
+
+/* 힙 프로파일러 관련 상수 */
+#define PROF_DEPTH 32                // 샘플 하나에 남기는 스택 프레임 수 상한
+#define PROF_STACKS 1024             // 서로 다른 할당 스택 수 상한. 넘치면 그 샘플은 버림
+#define PROF_LIVE_BITS 13            // 살아있는 샘플 해시 테이블 크기 2^13. 샘플은 절반까지만 넣음
+
+
+/* 크기 클래스 인덱스 관련 상수 (MM_SIZE_INDEX) */
+#define IDX_CLASSES 20               // 클래스 c는 [2^(c+5), 2^(c+6)) 바이트. 마지막 클래스는 그 이상 전부
+#define IDX_HEAP_MAX (20*(1<<20))    // config.h의 MAX_HEAP. 클래스별 배열 크기의 상한을 여기서 잡음
+#define IDX_POOL (IDX_HEAP_MAX / (2*MIN_BLOCK_SIZE) + IDX_HEAP_MAX / 32 + IDX_CLASSES) // 모든 클래스 상한의 합보다 큼
+
+#if defined(MM_SIZE_INDEX) && (defined(MM_SIZE_CACHE) || defined(MM_SHARED))
+#error "MM_SIZE_INDEX uses the node word of MM_SIZE_CACHE and keeps the index in process memory (no MM_SHARED)"
+#endif
+#if defined(MM_SIMD) && !defined(MM_SIZE_INDEX)
+#error "MM_SIMD only applies to MM_SIZE_INDEX"
+#endif
+#if defined(MM_SIMD) && !defined(__AVX2__) && !defined(__SSE4_1__)
+#error "MM_SIMD needs -mavx2 or -msse4.1"
+#endif
+
+
+/* 지연 free 관련 상수 (MM_THREADS) */
+#define DRAIN_INTERVAL_NS 50000      // 백그라운드 스레드가 pending 큐를 비우는 주기 (50us)
+
 
 /* 유틸 매크로 */
 // /* Move the address ptr by offset bytes */
@@ -92,7 +195,12 @@ team_t team = {
 #define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~(ALIGNMENT-1)) // DSIZE의 배수로 올림 정렬 
 #define PACK(size, alloc) ((size) | (alloc)) // size 및 할당 비트를 워드 1개에 패킹
 #define GET(p) (*(WTYPE  *)(p)) // 주소 p에 있는 워드를 읽기
+#ifdef MM_SHARED
+static void undo_note(void *p);
+#define PUT(p, val) (undo_note(p), *(WTYPE  *)(p) = (val)) // 덮어쓰기 전 값을 undo 로그에 남기고 쓰기
+#else
 #define PUT(p, val) (*(WTYPE  *)(p) = (val)) // 주소 p에 있는 워드를 쓰기
+#endif
 #define GET_SIZE(p) (GET(p) & ~0x7) // 헤더/푸터에서 크기 비트 읽기
 #define GET_ALLOC(p) (GET(p) & 0x1) // 헤더/푸터에서 할당 비트 읽기
 #define HDRP(bp) ((char *)(bp) - WSIZE) // 블록 포인터 bp에 대하여, 헤더의 주소를 계산
@@ -108,10 +216,66 @@ team_t team = {
 #define PRED_PTR(bp)  ((char *)(bp))
 #define SUCC_PTR(bp)  ((char *)(bp) + PTR_SIZE)
 
+#ifdef MM_SHARED
+/* 공유 힙은 프로세스마다 매핑 주소가 다르므로 링크는 heap_base 기준 오프셋으로 저장. 0은 NULL */
+#define TO_OFF(p)     ((p) ? (WTYPE)((char *)(p) - heap_base) : 0)
+#define FROM_OFF(o)   ((o) ? (void *)(heap_base + (o)) : NULL)
+#define GET_PRED(bp)  FROM_OFF(*(WTYPE *)PRED_PTR(bp))
+#define GET_SUCC(bp)  FROM_OFF(*(WTYPE *)SUCC_PTR(bp))
+#define SET_PRED(bp, p) PUT(PRED_PTR(bp), TO_OFF(p)) // 링크도 PUT으로 써야 undo 로그에 남음
+#define SET_SUCC(bp, q) PUT(SUCC_PTR(bp), TO_OFF(q))
+#else
 #define GET_PRED(bp)  (*(void **)(PRED_PTR(bp)))  // 이전 블록 위치를 얻기 
 #define GET_SUCC(bp)  (*(void **)(SUCC_PTR(bp)))  // 다음 블록 위치를 얻기
 #define SET_PRED(bp, p) (GET_PRED(bp) = (p))  // 이전 블록 위치를 설정
 #define SET_SUCC(bp, q) (GET_SUCC(bp) = (q))  // 다음 블록 위치를 설정
+#endif
+
+/* free 노드의 크기. MM_SIZE_CACHE면 succ 바로 뒤 워드의 사본을 읽으므로 헤더(bp 앞 워드)를 안 건드림.
+ * 사본은 insert_node가 쓰니, 리스트에 든 채로 크기가 바뀌는 곳은 SET_NODE_SIZE로 같이 고쳐야 함 */
+#ifdef MM_SIZE_CACHE
+#define NSIZE_PTR(bp)  ((char *)(bp) + 2*PTR_SIZE)
+#define GET_NODE_SIZE(bp)  (*(WTYPE *)NSIZE_PTR(bp))
+#define SET_NODE_SIZE(bp, sz)  PUT(NSIZE_PTR(bp), (sz))
+#define NODE_LINE(bp)  ((char *)(bp))        // 링크와 크기가 한 캐시 라인
+#else
+#define GET_NODE_SIZE(bp)  GET_SIZE(HDRP(bp))
+#define SET_NODE_SIZE(bp, sz)
+#define NODE_LINE(bp)  HDRP(bp)              // 헤더와 succ (보통 같은 라인)
+#endif
+
+/* 인덱스 모드에서 free 노드의 세 번째 워드: 크기 클래스 배열 안에서 이 블록의 칸 번호 */
+#define IDX_POS(bp)  (*(WTYPE *)((char *)(bp) + 2*PTR_SIZE))
+
+/* find_fit이 다음 노드를 미리 가져오게 함. NULL이어도 prefetch는 fault 안 남 */
+#ifdef MM_PREFETCH
+#define PREFETCH_NODE(bp)  __builtin_prefetch(NODE_LINE(bp))
+#else
+#define PREFETCH_NODE(bp)
+#endif
+
+/* 배치 결정 이벤트 로그 (MM_EVENTS). 끄면 호출 자체가 없어짐. 인자는 mm-events.h의 필드 순서 */
+#ifdef MM_EVENTS
+#define EVENT(op, size, bp, search, outcome)  ev_log((op), (size), (bp), (search), (outcome))
+#else
+#define EVENT(op, size, bp, search, outcome)
+#endif
+
+/**
+ * USDT 정적 프로브 (MM_USDT). provider는 mm: perf probe -x mdriver sdt_mm:malloc_entry, bpftrace면 usdt:./mdriver:mm:malloc_entry
+ *   malloc_entry(size)          malloc_return(size, bp)
+ *   free_entry(bp, 블록 크기)    free_return(bp)
+ *   realloc_entry(ptr, size)    realloc_return(ptr, size, bp)
+ *   extend_heap(새 블록, 늘린 바이트)
+ *   coalesce(병합된 블록, 크기, 케이스 1~4)
+ *   split(할당 블록, asize, 남은 free 블록, 남은 크기)
+ * 프로브 자리는 nop 하나이고 인자는 이미 손에 있는 값만 넘김 → 아무도 안 붙어 있으면 사실상 비용 없음. 끄면 빈 매크로
+ */
+#ifdef MM_USDT
+#define PROBE(name, ...)  STAP_PROBEV(mm, name, __VA_ARGS__)
+#else
+#define PROBE(name, ...)
+#endif
 
 
 
@@ -125,9 +289,147 @@ team_t team = {
 
 
 /* 전역 변수 */
+static void *heap_malloc(size_t asize);
+static void *malloc_block(size_t size);
+static void prof_forget(void *bp);
+static void free_block(void *bp);
 static char *heap_listp = NULL; // 맨 처음 블록 포인터
 static void *free_list_head = NULL; // Explicit free list의 출발점
 static void *rover = NULL;  // Next-fit용 탐색 포인터
+static size_t free_bytes = 0; // free list에 들어있는 블록들의 크기 합 (adaptive 단편화 측정용)
+
+/* 배치 정책 */
+static mm_fit_policy_t fit_request = MM_FIT_NEXT; // mm_set_fit_policy로 받은 정책. 다음 mm_init부터 적용
+static mm_fit_policy_t fit_policy = MM_FIT_NEXT;  // 지금 find_fit이 쓰는 정책 (adaptive면 수시로 바뀜)
+static mm_place_policy_t place_policy = MM_PLACE_LOW; // place의 분할 방식
+static size_t win_fits = 0;   // adaptive: 이번 윈도우의 find_fit 호출 수
+static size_t win_visits = 0; // adaptive: 이번 윈도우에서 find_fit이 방문한 노드 수
+static int fit_profile_request = 0;   // mm_set_fit_profile로 받은 설정. 다음 mm_init부터 적용
+static int fit_profile = 0;           // 이번 힙에서 find_fit 사이클을 재는지
+static mm_fit_stats_t fit_stats;      // find_fit 호출/방문 노드/사이클 (마지막 mm_init 이후)
+static int phase_profile_request = 0; // mm_set_phase_profile로 받은 설정. 다음 mm_init부터 적용
+static int phase_profile = 0;         // 이번 힙에서 단계별 사이클을 재는지
+static mm_phase_stats_t phase_stats;  // 단계별 사이클/횟수 (마지막 mm_init 이후)
+
+/* mm_stats 카운터 (마지막 mm_init 이후). 증가 하나씩이라 항상 켜 둠 */
+static size_t live_blocks = 0;                 // 할당 상태인 힙 블록 수
+static size_t extend_calls = 0;                // extend_heap 호출 수
+static size_t search_hist[MM_STATS_SEARCHES];  // find_fit이 방문한 노드 수의 log2 히스토그램
+static size_t coalesce_hist[4];                // coalesce 케이스 1~4
+
+#ifdef MM_SIZE_INDEX
+/* 크기 클래스 인덱스. 배열들은 IDX_POOL 하나를 클래스별 상한만큼 나눠 씀 (BSS라 안 건드린 페이지는 메모리를 안 먹음) */
+static uint32_t idx_size_pool[IDX_POOL], idx_off_pool[IDX_POOL];
+static struct idx_class {
+    uint32_t *size;   // 블록 크기들. find_fit이 훑는 배열
+    uint32_t *off;    // 같은 칸 블록의 bp - idx_base
+    size_t n, cap;
+} idx_class[IDX_CLASSES];
+static char *idx_base = NULL;         // 오프셋의 기준 (mem_heap_lo)
+#endif
+
+/* 힙 확장 */
+static size_t grow_chunk = CHUNKSIZE; // 꼬리 블록이 할당 상태일 때 늘릴 청크 크기 (확장 빈도에 따라 변함)
+static size_t malloc_count = 0;       // 지금까지의 mm_malloc 호출 수
+static size_t grow_last = 0;          // 직전 힙 확장 때의 malloc_count
+
+/* 수명 예측 & nursery */
+static int nursery_request = 0;       // mm_set_nursery로 받은 설정. 다음 mm_init부터 적용
+static int nursery_on = 0;            // 이번 힙에서 예측기/nursery를 쓰는지
+static char *nursery_lo = NULL;       // nursery 영역 시작 (힙 안의 할당 블록 하나의 payload)
+static char *nursery_top = NULL;      // bump pointer
+static char *nursery_end = NULL;      // nursery 영역 끝
+static size_t nursery_live = 0;       // nursery에 살아있는 객체 수. 0이 되면 한 번에 회수
+static size_t life_clock = 0;         // 예측기용 시계: malloc/free마다 1씩
+static unsigned char life_hist[LIFE_BUCKETS]; // 크기별 2비트 포화 카운터. 2 이상이면 단명 예측
+static struct {
+    void *bp;              // 추적 중인 힙 블록 (NULL이면 빈 칸)
+    size_t birth;          // 할당 시점의 life_clock
+    unsigned short bucket; // life_hist 칸
+    unsigned char predicted_short;
+} life_track[LIFE_TRACK];
+static mm_lifetime_stats_t life_stats;
+
+/* 핸들 & compaction */
+struct mm_hslot {
+    void *bp;    // 핸들 블록의 bp. 빈 슬롯이면 NULL
+    size_t lock; // mm_hlock 횟수. 0이 아니면 compaction이 옮기지 않음. 빈 슬롯이면 다음 빈 슬롯 번호
+};
+static struct mm_hslot hslot_tab;          // 슬롯 테이블 블록 자신의 슬롯 (테이블도 옮겨지므로)
+static size_t hslot_cap = 0;               // 슬롯 테이블 크기
+static size_t hslot_free = 0;              // 첫 빈 슬롯 번호. 0이면 없음
+static void *compact_cur = NULL;           // 진행 중인 compaction pass의 위치 (블록 bp). NULL이면 다음 호출 때 힙 처음부터
+
+/* 힙 프로파일러 */
+static size_t prof_request = 0;            // mm_set_heap_sampling으로 받은 평균 샘플 간격(바이트). 다음 mm_init부터 적용
+static size_t prof_period = 0;             // 이번 힙의 샘플 간격. 0이면 꺼짐
+static int64_t prof_countdown = INT64_MAX; // 다음 샘플까지 남은 요청 바이트. 꺼져 있으면 안 닿는 값
+static uint64_t prof_rng;                  // 샘플 간격을 뽑는 xorshift 상태
+static struct prof_stack {
+    uint64_t hash;                  // pc들의 해시 (비교 먼저 거르기용)
+    int depth;
+    void *pc[PROF_DEPTH];
+    size_t live_objs, live_bytes;   // 지금 살아있는 샘플
+    size_t alloc_objs, alloc_bytes; // 마지막 mm_init 이후의 모든 샘플
+} prof_stacks[PROF_STACKS];
+static size_t prof_nstacks = 0;
+static struct prof_live {
+    void *bp;                       // 샘플된 블록. NULL이면 빈 칸
+    size_t size;                    // 요청 크기
+    struct prof_stack *stack;
+} prof_live[1 << PROF_LIVE_BITS];
+static size_t prof_nlive = 0;              // prof_live에 든 샘플 수
+
+/* 공유 힙 (MM_SHARED) */
+#ifdef MM_SHARED
+static char *heap_base = NULL; // 이 프로세스에서 힙이 매핑된 주소 (mem_heap_lo). 오프셋의 기준
+#define UNDO_MAX 160           // 연산 하나가 쓰는 헤더/푸터/링크 워드 수의 상한 (넉넉히)
+typedef struct {               // memlib의 세그먼트 헤더(mem_shared_area)에 두는 루트들 = superblock
+    WTYPE heap_listp, free_list_head, rover; // heap_base 기준 오프셋
+    WTYPE user_root;           // mm_set_root로 받은 사용자 루트 (오프셋)
+    size_t free_bytes, grow_chunk, malloc_count, grow_last, win_fits, win_visits;
+    size_t live_blocks;
+    size_t heap_extent;        // 루트를 마지막으로 쓸 때의 힙 크기. brk와 다르면 중간에 죽은 것
+    int fit_policy;
+    int initialized;
+    int clean;                 // mm_shutdown이 1로, 락을 잡을 때마다 0으로. 0인 채로 다시 붙으면 검사
+    int undo_n;                // 이번 락 구간의 undo 기록 수. UNDO_MAX보다 크면 넘친 것
+    struct { WTYPE off, old; } undo[UNDO_MAX]; // 락을 잡은 뒤 덮어쓴 힙 워드와 원래 값. UNLOCK 때 비움
+} shm_roots_t;
+typedef char shm_roots_fit[sizeof(shm_roots_t) <= MEM_SHARED_AREA ? 1 : -1]; // 헤더 자리를 넘으면 컴파일 에러
+static void roots_load(void);
+static void roots_store(void);
+static int roots_clean = 0;    // 마지막 roots_load 때 본 clean 플래그
+static shm_roots_t *undo_roots = NULL; // undo 로그를 남길 세그먼트 헤더. 공유 모드가 아니면 NULL
+static void *user_root = NULL; // 재시작 후에 사용자가 자기 데이터를 다시 찾는 진입점
+#endif
+static int heap_recovered = 0; // 마지막 mm_init이 힙 검사 & free list 재구성을 했는지
+
+/* 스레드 & 지연 free */
+#ifdef MM_THREADS
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER; // 힙 전체 락. 공개 함수 진입점에서만 잡음
+static int drain_started = 0;                                 // 백그라운드 스레드를 띄웠는지
+#endif
+#if defined(MM_SHARED) && defined(MM_THREADS)
+// 공유 mutex는 mem_init_shared로 붙었을 때만 잡히므로 프로세스 안 스레드용 락도 같이 잡음. 순서는 항상 스레드 락 먼저
+#define LOCK()   (pthread_mutex_lock(&heap_lock), mem_shared_lock(), roots_load())
+#define UNLOCK() (roots_store(), mem_shared_unlock(), pthread_mutex_unlock(&heap_lock))
+#elif defined(MM_SHARED)
+#define LOCK()   (mem_shared_lock(), roots_load())    // 락을 잡고 다른 프로세스가 바꿔 놓은 루트를 읽어 옴
+#define UNLOCK() (roots_store(), mem_shared_unlock()) // 루트를 써 두고 락을 놓음
+#elif defined(MM_THREADS)
+#define LOCK()   pthread_mutex_lock(&heap_lock)
+#define UNLOCK() pthread_mutex_unlock(&heap_lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+static int deferred_request = 0;   // mm_set_deferred_free로 받은 설정. 다음 mm_init부터 적용
+static int deferred_on = 0;        // 이번 힙에서 지연 free를 쓰는지
+static void *pending_head = NULL;  // pending 큐(Treiber 스택) 머리. atomic으로만 접근
+static size_t pending_pushed = 0;  // 큐에 들어간 블록 수. atomic으로만 접근
+static size_t drained_bg = 0, drained_fg = 0, fg_drains = 0;
+static uint64_t lag_sum_ns = 0, lag_max_ns = 0;
 
 
 /** 참고: 함수에 `static`는 왜 붙이는가? 
@@ -140,6 +442,88 @@ static void *rover = NULL;  // Next-fit용 탐색 포인터
  *        - 걍 '좋다'는 거지, 반드시 인라인 삽입을 보장하진 않음.
 */
 
+/**
+ * read_cycles: find_fit 측정용 사이클 카운터. x86은 rdtsc, 그 밖에는 CLOCK_MONOTONIC 나노초
+ */
+static inline uint64_t read_cycles(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+/* 단계별 비용 측정 (mm_set_phase_profile). 꺼져 있으면 분기 하나씩 */
+#define PHASE_START()         (phase_profile ? read_cycles() : 0)
+#define PHASE_STOP(ph, t0)    do { if (phase_profile) { phase_stats.cycles[ph] += read_cycles() - (t0); phase_stats.calls[ph]++; } } while (0)
+
+#ifdef MM_EVENTS
+/**
+ * 이벤트 링: 스레드마다 파일 하나(<MM_EVLOG>.<pid>.<tid>)를 MAP_SHARED로 매핑해 둠.
+ * 쓰는 스레드가 하나뿐이라 락 없이 칸을 채우고 head만 release로 올림.
+ * 파일 매핑이라 프로세스가 죽어도 기록은 페이지 캐시에 남고, mm-evdump로 읽음.
+ * 그 사이의 결정 이벤트(fit/place/coalesce/grow)는 순서(seq)로만 구분
+ */
+static __thread mm_ev_ring_t *ev_ring = NULL;
+static __thread int ev_failed = 0; // 파일을 못 만들었으면 이 스레드는 기록을 포기
+
+static mm_ev_ring_t *ev_open(void) {
+    const char *prefix = getenv("MM_EVLOG");
+    size_t len = sizeof(mm_ev_ring_t) + MM_EV_RING * sizeof(mm_event_t);
+    long tid = syscall(SYS_gettid);
+    char path[256];
+    int fd;
+    void *p;
+
+    snprintf(path, sizeof(path), "%s.%ld.%ld", prefix ? prefix : "mm-evlog", (long)getpid(), tid);
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, len) < 0) {
+        if (fd >= 0)
+            close(fd);
+        ev_failed = 1;
+        return NULL;
+    }
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        ev_failed = 1;
+        return NULL;
+    }
+
+    ev_ring = p;
+    ev_ring->rec_size = sizeof(mm_event_t);
+    ev_ring->capacity = MM_EV_RING;
+    ev_ring->pid = getpid();
+    ev_ring->tid = tid;
+    ev_ring->magic = MM_EV_MAGIC; // 매직은 맨 나중에. 이게 있어야 mm-evdump가 파일을 읽음
+    return ev_ring;
+}
+
+/* inline하지 않음: 안에 ev_open 호출이 있어서, 인라인되면 find_fit이 callee-saved 레지스터를 하나 더 쓰게 되고
+ * 리스트 커서가 %rbp로 밀려남. 그러면 이 머신(Xeon)에서는 노드당 6 → 17 사이클로 느려졌음 (mdriver -F) */
+static __attribute__((noinline)) void ev_log(uint32_t op, size_t size, void *bp, size_t search, size_t outcome) {
+    mm_ev_ring_t *r = ev_ring;
+
+    if (r == NULL && (ev_failed || (r = ev_open()) == NULL))
+        return;
+
+    uint64_t h = r->head;
+    mm_event_t *e = &r->rec[h & (MM_EV_RING - 1)];
+
+    e->tsc = op <= MM_EV_REALLOC ? read_cycles() : 0; // 시각은 공개 함수 이벤트에만. VM에서는 rdtsc 하나가 기록 전체보다 비쌈
+    e->block = (uintptr_t)bp;
+    e->op = op;
+    e->size = (uint32_t)size;
+    e->search = (uint32_t)search;
+    e->outcome = (uint32_t)outcome;
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+#endif
+
 /** 
  * adjust_block: 크기를 MIN_BLOCK_SIZE 단위로 맞추되, 헤더 & 푸터(16 바이트) 포함치
  */
@@ -149,10 +533,196 @@ static inline size_t adjust_block(size_t size) {
     return (asize < MIN_BLOCK_SIZE) ? MIN_BLOCK_SIZE : asize;
 }
 
+#ifdef MM_SIZE_INDEX
+/* ========================== 크기 클래스 인덱스 =============================== */
+
+/**
+ * size_class: 크기 클래스 번호. floor(log2(size)) - 5, 0 ~ IDX_CLASSES-1로 자름
+ */
+static inline int size_class(size_t size) {
+    int c = (int)(sizeof(unsigned long) * 8 - 1) - __builtin_clzl((unsigned long)size) - 5;
+    return c < 0 ? 0 : c >= IDX_CLASSES ? IDX_CLASSES - 1 : c;
+}
+
+/**
+ * idx_init: 빈 인덱스. 클래스 c의 상한은 "가장 작은 블록 + 그 사이의 할당 블록"으로 힙을 채울 때의 개수
+ * (coalesce 덕분에 free 블록끼리는 붙어 있지 않음)
+ */
+static void idx_init(void) {
+    size_t used = 0;
+
+    idx_base = mem_heap_lo();
+    for (int c = 0; c < IDX_CLASSES; c++) {
+        size_t lo = MAX((size_t)1 << (c + 5), MIN_BLOCK_SIZE);
+        idx_class[c].size = idx_size_pool + used;
+        idx_class[c].off = idx_off_pool + used;
+        idx_class[c].n = 0;
+        idx_class[c].cap = IDX_HEAP_MAX / (lo + MIN_BLOCK_SIZE) + 1;
+        used += idx_class[c].cap;
+    }
+}
+
+/**
+ * idx_insert: 클래스 배열 끝에 (size, 오프셋) 추가하고 칸 번호를 노드에 적어 둠
+ */
+static inline void idx_insert(void *bp, size_t size) {
+    struct idx_class *k = &idx_class[size_class(size)];
+
+    IDX_POS(bp) = k->n;
+    k->size[k->n] = (uint32_t)size;
+    k->off[k->n] = (uint32_t)((char *)bp - idx_base);
+    k->n++;
+}
+
+/**
+ * idx_remove: 마지막 칸을 bp 자리로 옮겨 채움. 옮겨진 블록의 칸 번호도 고침
+ */
+static inline void idx_remove(void *bp, size_t size) {
+    struct idx_class *k = &idx_class[size_class(size)];
+    size_t i = IDX_POS(bp), last = --k->n;
+
+    if (i != last) {
+        k->size[i] = k->size[last];
+        k->off[i] = k->off[last];
+        IDX_POS(idx_base + k->off[i]) = i;
+    }
+}
+
+/*
+ * 크기 배열 훑기. idx_first는 asize 이상인 첫 칸, idx_best는 asize 이상 중 가장 작은 칸(같으면 앞 칸).
+ * 없으면 n. 크기는 2^31보다 작으니 SIMD에서는 signed 비교(> asize-1)로 충분함
+ */
+#ifdef MM_SIMD
+#ifdef __AVX2__
+#define VEC __m256i
+#define VLANES 8
+#define VLOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define VSTORE(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define VSET1(x) _mm256_set1_epi32((int)(x))
+#define VGT(a, b) _mm256_cmpgt_epi32(a, b)
+#define VEQ(a, b) _mm256_cmpeq_epi32(a, b)
+#define VMINU(a, b) _mm256_min_epu32(a, b)
+#define VOR(a, b) _mm256_or_si256(a, b)
+#define VANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define VMASK(m) _mm256_movemask_ps(_mm256_castsi256_ps(m))
+#else /* SSE4.1 */
+#define VEC __m128i
+#define VLANES 4
+#define VLOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define VSTORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define VSET1(x) _mm_set1_epi32((int)(x))
+#define VGT(a, b) _mm_cmpgt_epi32(a, b)
+#define VEQ(a, b) _mm_cmpeq_epi32(a, b)
+#define VMINU(a, b) _mm_min_epu32(a, b)
+#define VOR(a, b) _mm_or_si128(a, b)
+#define VANDNOT(a, b) _mm_andnot_si128(a, b)
+#define VMASK(m) _mm_movemask_ps(_mm_castsi128_ps(m))
+#endif
+
+static size_t idx_first(const uint32_t *sz, size_t n, uint32_t asize) {
+    VEC t = VSET1(asize - 1);
+    size_t i = 0;
+
+    for (; i + VLANES <= n; i += VLANES) {
+        int m = VMASK(VGT(VLOAD(sz + i), t));
+        if (m)
+            return i + __builtin_ctz(m);
+    }
+    while (i < n && sz[i] < asize)
+        i++;
+    return i;
+}
+
+static size_t idx_best(const uint32_t *sz, size_t n, uint32_t asize) {
+    VEC t = VSET1(asize - 1), ones = VSET1(-1), acc = ones, e;
+    uint32_t lanes[VLANES], b = UINT32_MAX;
+    size_t i = 0;
+
+    /* 1) 맞는 칸들의 최솟값. 안 맞는 칸은 UINT32_MAX로 바꿔서 min */
+    for (; i + VLANES <= n; i += VLANES) {
+        VEC v = VLOAD(sz + i);
+        acc = VMINU(acc, VOR(v, VANDNOT(VGT(v, t), ones)));
+    }
+    VSTORE(lanes, acc);
+    for (int k = 0; k < VLANES; k++)
+        b = MIN(b, lanes[k]);
+    for (; i < n; i++)
+        if (sz[i] >= asize && sz[i] < b)
+            b = sz[i];
+    if (b == UINT32_MAX)
+        return n;
+
+    /* 2) 그 값인 첫 칸 */
+    e = VSET1(b);
+    for (i = 0; i + VLANES <= n; i += VLANES) {
+        int m = VMASK(VEQ(VLOAD(sz + i), e));
+        if (m)
+            return i + __builtin_ctz(m);
+    }
+    while (sz[i] != b)
+        i++;
+    return i;
+}
+#else /* 스칼라 */
+static size_t idx_first(const uint32_t *sz, size_t n, uint32_t asize) {
+    size_t i = 0;
+
+    while (i < n && sz[i] < asize)
+        i++;
+    return i;
+}
+
+static size_t idx_best(const uint32_t *sz, size_t n, uint32_t asize) {
+    size_t best = n;
+
+    for (size_t i = 0; i < n; i++) {
+        if (sz[i] < asize || (best < n && sz[i] >= sz[best]))
+            continue;
+        best = i;
+        if (sz[i] == asize)
+            break;
+    }
+    return best;
+}
+#endif /* MM_SIMD */
+
+/**
+ * find_fit_idx: asize의 클래스부터 위로 올라가며 인덱스에서 찾음. 위 클래스의 블록은 전부 들어가므로
+ * first fit이면 첫 칸, best fit이면 그 클래스의 최솟값
+ */
+static __attribute__((noinline)) void *find_fit_idx(size_t asize, int best, size_t *visits) {
+    size_t n = 0;
+
+    *visits = 0;
+    if (asize > UINT32_MAX) // 인덱스는 크기를 uint32로 들고 있음. 잘려서 작은 블록에 맞는 일이 없게 바로 실패
+        return NULL;
+    for (int c = size_class(asize); c < IDX_CLASSES; c++) {
+        struct idx_class *k = &idx_class[c];
+        size_t i = best ? idx_best(k->size, k->n, asize) : idx_first(k->size, k->n, asize);
+
+        n += (best || i == k->n) ? k->n : i + 1;
+        if (i < k->n) {
+            *visits = n;
+            return idx_base + k->off[i];
+        }
+    }
+    *visits = n;
+    return NULL;
+}
+
+/* ========================== End of 크기 클래스 인덱스 =============================== */
+#endif /* MM_SIZE_INDEX */
+
 /**
  * insert_node: 빈 블록 `bp`를 explicit free list의 머리에 LIFO로 삽입
  */
 static void insert_node(void* bp){
+    free_bytes += GET_SIZE(HDRP(bp));
+    SET_NODE_SIZE(bp, GET_SIZE(HDRP(bp)));
+#ifdef MM_SIZE_INDEX
+    idx_insert(bp, GET_SIZE(HDRP(bp)));
+#endif
+
     SET_SUCC(bp, free_list_head);
     SET_PRED(bp, NULL);
 
@@ -172,7 +742,11 @@ static void remove_node(void* bp){
     void *pred = GET_PRED(bp);
     void *succ = GET_SUCC(bp);
 
-    
+    free_bytes -= GET_SIZE(HDRP(bp));
+#ifdef MM_SIZE_INDEX
+    idx_remove(bp, GET_SIZE(HDRP(bp)));
+#endif
+
     /* 1) bp의 predecessor가 있으면, 그 successor를 bp의 successor로 */
     if (pred != NULL) {
         SET_SUCC(pred, succ);
@@ -188,82 +762,320 @@ static void remove_node(void* bp){
         rover = succ ? succ : pred ? pred : free_list_head;
 }
 
+#ifndef MM_SIZE_INDEX /* 인덱스 빌드의 find_fit은 리스트를 안 훑음 */
 /**
- * find_fit: 해당 asize에 맞는 곳 찾기 (first-fit 탐색)
+ * find_fit_ff: 해당 asize에 맞는 곳 찾기 (first-fit 탐색)
+ * - visits: 방문한 노드 수를 돌려줌 (adaptive 정책의 표본)
  */
-static void *find_fit_ff(size_t asize){ // 얘는 기존의 first-fit 탐색
-    void *bp;
-
-    for (bp = free_list_head; bp != NULL; bp = GET_SUCC(bp)){
-        if (GET_SIZE(HDRP(bp)) >= asize)
-            return bp;
+static __attribute__((noinline)) void *find_fit_ff(size_t asize, size_t *visits){ // 얘는 기존의 first-fit 탐색
+    void *bp, *next;
+    size_t n = 0;
+
+    for (bp = free_list_head; bp != NULL; bp = next){
+        next = GET_SUCC(bp);
+        PREFETCH_NODE(next); // 크기 비교하는 동안 다음 노드를 가져오게
+        n++;
+        if (GET_NODE_SIZE(bp) >= asize)
+            break;
     }
-    return NULL; // 못 찾았다
+    *visits = n;
+    return bp; // 못 찾았으면 NULL
 }
 
-static void *find_fit(size_t asize) {
+/**
+ * find_fit_nf: next-fit 탐색. rover부터 tail까지, 그 다음 head부터 rover 앞까지
+ */
+static __attribute__((noinline)) void *find_fit_nf(size_t asize, size_t *visits) {
+    size_t n = 0;
+
     if (!rover) 
         rover = free_list_head;
 
     /* 1. tail까지 */
-    for (void *bp = rover; bp; bp = GET_SUCC(bp))
-        if (GET_SIZE(HDRP(bp)) >= asize) { 
+    for (void *bp = rover, *next; bp; bp = next) {
+        next = GET_SUCC(bp);
+        PREFETCH_NODE(next);
+        n++;
+        if (GET_NODE_SIZE(bp) >= asize) { 
             rover = bp; 
+            *visits = n;
             return bp; 
         }
+    }
 
     /* 2. head부터 tail앞까지 wrap */
-    for (void *bp = free_list_head; bp && bp != rover; bp = GET_SUCC(bp))
-        if (GET_SIZE(HDRP(bp)) >= asize) { 
+    for (void *bp = free_list_head, *next; bp && bp != rover; bp = next) {
+        next = GET_SUCC(bp);
+        PREFETCH_NODE(next);
+        n++;
+        if (GET_NODE_SIZE(bp) >= asize) { 
             rover = bp; 
+            *visits = n;
             return bp; 
         }
+    }
+    *visits = n;
     return NULL;
 }
 
 /**
- * place: asize 바이트를 bp에 할당
+ * find_fit_bf: best-fit 탐색. 맞는 블록 중 가장 작은 것을 고름
+ * - max_cands가 0이면 리스트 전체를 보는 best fit
+ * - 0이 아니면 맞는 후보를 max_cands개 찾은 시점에서 멈추는 good fit
+ * - 딱 맞는 블록을 만나면 바로 반환
+ */
+static __attribute__((noinline)) void *find_fit_bf(size_t asize, size_t max_cands, size_t *visits) {
+    void *best = NULL;
+    size_t best_size = (size_t)-1;
+    size_t cands = 0, n = 0;
+
+    for (void *bp = free_list_head, *next; bp != NULL; bp = next) {
+        size_t bsize = GET_NODE_SIZE(bp);
+        next = GET_SUCC(bp);
+        PREFETCH_NODE(next);
+        n++;
+        if (bsize < asize)
+            continue;
+        if (bsize < best_size) {
+            best = bp;
+            best_size = bsize;
+            if (bsize == asize)
+                break;
+        }
+        if (max_cands && ++cands >= max_cands)
+            break;
+    }
+    *visits = n;
+    return best;
+}
+#endif
+
+/**
+ * adapt_policy: adaptive 모드에서 ADAPT_WINDOW번의 find_fit마다 정책을 다시 고름
+ * - 탐색이 짧으면 어차피 싸니까 best fit
+ * - 탐색이 긴데 단편화(free 바이트 / 힙 크기)가 높으면 후보 수를 제한한 good fit
+ * - 탐색이 길고 단편화도 낮으면 가장 빠른 next fit
+ */
+static void adapt_policy(void) {
+    size_t heapsize = mem_heapsize();
+    int frag_high = heapsize && (free_bytes * 1000 / heapsize > ADAPT_FRAG_HIGH);
+    int search_long = (win_visits / win_fits) > ADAPT_SEARCH_LONG;
+
+    if (!search_long)
+        fit_policy = MM_FIT_BEST;
+    else
+        fit_policy = frag_high ? MM_FIT_GOOD : MM_FIT_NEXT;
+
+    win_fits = 0;
+    win_visits = 0;
+}
+
+/**
+ * search_bucket: 방문 노드 수 n의 히스토그램 칸. 0개는 0번, [2^(b-1), 2^b)개는 b번 (마지막 칸은 나머지 전부)
+ */
+static inline unsigned search_bucket(size_t n) {
+    unsigned b = n ? 64 - __builtin_clzll(n) : 0; // n의 비트 수
+    return MIN(b, MM_STATS_SEARCHES - 1);
+}
+
+/**
+ * find_fit: 현재 배치 정책에 따라 asize에 맞는 free 블록을 찾음
+ * - 탐색 함수(find_fit_*)는 일부러 인라인하지 않음. 여기 뒤쪽 통계 코드에 함수 호출이 있어서 인라인되면
+ *   리스트 커서가 callee-saved 레지스터로 가는데, %rbp에 잡히면 이 머신(Xeon)에서 노드당 6 → 17 사이클이 됨
+ */
+static void *find_fit(size_t asize) {
+    void *bp;
+    size_t visits;
+    uint64_t t0 = fit_profile ? read_cycles() : 0;
+    uint64_t pt = PHASE_START();
+
+#ifdef MM_SIZE_INDEX /* 인덱스에는 rover가 없으니 first/next는 first fit, best/good은 best fit */
+    bp = find_fit_idx(asize, fit_policy == MM_FIT_BEST || fit_policy == MM_FIT_GOOD, &visits);
+#else
+    switch (fit_policy) {
+    case MM_FIT_FIRST:
+        bp = find_fit_ff(asize, &visits);
+        break;
+    case MM_FIT_BEST:
+        bp = find_fit_bf(asize, 0, &visits);
+        break;
+    case MM_FIT_GOOD:
+        bp = find_fit_bf(asize, GOOD_FIT_CANDIDATES, &visits);
+        break;
+    default:
+        bp = find_fit_nf(asize, &visits);
+        break;
+    }
+#endif
+    PHASE_STOP(MM_PHASE_SEARCH, pt);
+
+    if (fit_profile) {
+        fit_stats.cycles += read_cycles() - t0;
+        fit_stats.fits++;
+        fit_stats.visits += visits;
+    }
+    if (fit_request == MM_FIT_ADAPTIVE) {
+        win_fits++;
+        win_visits += visits;
+        if (win_fits >= ADAPT_WINDOW)
+            adapt_policy();
+    }
+    search_hist[search_bucket(visits)]++;
+    EVENT(MM_EV_FIT, asize, bp, visits, 0);
+    return bp;
+}
+
+/**
+ * mm_set_fit_profile: find_fit의 호출 수, 방문 노드 수, 걸린 사이클 측정 켜기/끄기. 다음 mm_init부터 적용
+ * (호출 수와 방문 노드 수는 rdtsc 없이도 싸지만, 통계 전체를 같이 켜고 끔)
+ */
+int mm_set_fit_profile(int enable) {
+    fit_profile_request = enable;
+    return 0;
+}
+
+/**
+ * mm_fit_stats: 현재 힙(마지막 mm_init 이후)의 find_fit 통계
+ */
+void mm_fit_stats(mm_fit_stats_t *st) {
+    LOCK();
+    *st = fit_stats;
+    UNLOCK();
+}
+
+/**
+ * mm_stats: 힙 상태 스냅샷. 카운터는 복사만 하고, 크기 클래스별 free 바이트와 가장 큰 free 블록은
+ * free list를 한 번 훑어서 구함. live 바이트는 힙에서 free 바이트와 프롤로그/에필로그(4워드)를 뺀 나머지
+ */
+void mm_stats(struct mm_stats *st) {
+    memset(st, 0, sizeof(*st));
+    LOCK();
+    for (void *bp = free_list_head; bp != NULL; bp = GET_SUCC(bp)) {
+        size_t size = GET_SIZE(HDRP(bp));
+        unsigned c = 63 - __builtin_clzll(size); // floor(log2(size))
+
+        c = c < 5 ? 0 : MIN(c - 5, MM_STATS_CLASSES - 1);
+        st->free_by_class[c] += size;
+        st->free_bytes += size;
+        st->free_blocks++;
+        st->largest_free = MAX(st->largest_free, size);
+    }
+    st->heap_size = mem_heapsize();
+    st->live_bytes = st->heap_size > 4*WSIZE ? st->heap_size - 4*WSIZE - st->free_bytes : 0;
+    st->live_blocks = live_blocks;
+    st->ext_frag = st->free_bytes ? 1.0 - (double)st->largest_free / st->free_bytes : 0.0;
+    st->extend_calls = extend_calls;
+    memcpy(st->fit_search, search_hist, sizeof(search_hist));
+    memcpy(st->coalesce, coalesce_hist, sizeof(coalesce_hist));
+    UNLOCK();
+}
+
+/**
+ * mm_set_phase_profile: 탐색/분할/coalesce/힙 확장/realloc 복사의 사이클 측정 켜기/끄기. 다음 mm_init부터 적용
+ */
+int mm_set_phase_profile(int enable) {
+    phase_profile_request = enable;
+    return 0;
+}
+
+/**
+ * mm_phase_stats: 현재 힙(마지막 mm_init 이후)의 단계별 사이클
+ */
+void mm_phase_stats(mm_phase_stats_t *st) {
+    LOCK();
+    *st = phase_stats;
+    UNLOCK();
+}
+
+/**
+ * mm_set_fit_policy: 배치 정책 지정. 다음 mm_init부터 적용됨
+ */
+int mm_set_fit_policy(mm_fit_policy_t policy) {
+    if (policy < MM_FIT_FIRST || policy > MM_FIT_ADAPTIVE)
+        return -1;
+    fit_request = policy;
+    return 0;
+}
+
+/**
+ * mm_set_place_policy: place의 분할 방식 지정 (low 또는 two-ended)
+ */
+int mm_set_place_policy(mm_place_policy_t policy) {
+    if (policy != MM_PLACE_LOW && policy != MM_PLACE_TWO_ENDED)
+        return -1;
+    place_policy = policy;
+    return 0;
+}
+
+/**
+ * place: asize 바이트를 bp에 할당하고, 할당된 블록의 bp를 반환
  * 1) free list에서 제거
  * 2) 분할 가능 시 split
+ *    - 기본(MM_PLACE_LOW): 앞쪽을 할당하고 뒤쪽 나머지를 free로
+ *    - MM_PLACE_TWO_ENDED: 작은 요청은 앞쪽(낮은 주소)에서, PLACE_LARGE_MIN 이상인 큰 요청은
+ *      뒤쪽(높은 주소)에서 잘라냄. 크기·수명이 비슷한 블록끼리 모여서, 같이 free될 때
+ *      coalesce가 큰 free 블록을 다시 만들기 쉬움. 힙 확장으로 생긴 꼬리 블록에서도 큰 블록은
+ *      힙 끝 쪽에 붙으므로 wilderness 근처가 사실상 큰 블록 영역이 됨
  * 3) header/footer 마킹
  */
-static void place(void *bp, size_t asize){
+static void *place(void *bp, size_t asize){
     size_t csize = GET_SIZE(HDRP(bp));
+    uint64_t pt = PHASE_START();
 
     /* 1) 할당 전 리스트에서 제거 */
     remove_node(bp); // free 리스트에서 블록을 즉시 제거 => 할당 중인 상태가 리스트에 남지 않도록 함
+    live_blocks++;
 
     if (rover == bp)
         rover = GET_SUCC(bp);  // 로버가 제거될 블록을 가리키고 있었다면, 다음 노드로 옮기기
 
     /* 2) 분할이 가능 */
     if ((csize - asize) >= MIN_BLOCK_SIZE){
+        if (place_policy == MM_PLACE_TWO_ENDED && asize >= PLACE_LARGE_MIN) {
+            /* 큰 요청: 앞쪽 나머지를 free list에 다시 넣고 뒤쪽을 할당 */
+            SET_HEADER(bp, csize - asize, 0);
+            SET_FOOTER(bp, csize - asize, 0);
+            insert_node(bp);
+
+            bp = NEXT_BLKP(bp);
+
+            SET_HEADER(bp, asize, 1);
+            SET_FOOTER(bp, asize, 1);
+            EVENT(MM_EV_PLACE, csize, bp, 0, csize - asize);
+            PROBE(split, bp, asize, PREV_BLKP(bp), csize - asize); // 할당 블록, 크기, 남은 free 블록, 크기
+            PHASE_STOP(MM_PHASE_SPLIT, pt);
+            return bp;
+        }
+
         SET_HEADER(bp, asize, 1);
         SET_FOOTER(bp, asize, 1);
 
-        bp = NEXT_BLKP(bp);
+        void *rest = NEXT_BLKP(bp);
 
-        SET_HEADER(bp, csize - asize, 0);
-        SET_FOOTER(bp, csize - asize, 0);
+        SET_HEADER(rest, csize - asize, 0);
+        SET_FOOTER(rest, csize - asize, 0);
 
         /* 꼬리 블록을 free list에 삽입 */
-        insert_node(bp); // 남은 부분을 free list에 다시 추가
+        insert_node(rest); // 남은 부분을 free list에 다시 추가
+        EVENT(MM_EV_PLACE, csize, bp, 0, csize - asize);
+        PROBE(split, bp, asize, rest, csize - asize);
 
     /* 3) 분할이 불가능 */
     }else{ 
         SET_HEADER(bp, csize, 1);
         SET_FOOTER(bp, csize, 1);
+        EVENT(MM_EV_PLACE, csize, bp, 0, 0);
     }
 
-    // // 아래는 next-fit 시 필요 부분
-    // if (rover == bp)
-    //     rover = GET_SUCC(bp); //로버가 이 블록을 가리키고 있었다면, 다음 노드로 옮기기
+    PHASE_STOP(MM_PHASE_SPLIT, pt);
+    return bp;
 }
 
 /**
  *  coalesce: boundary tag의 합치기 및 병합된 블록의 포인터를 반환
  */
 static void *coalesce(void *bp){
+    uint64_t pt = PHASE_START();
     size_t prev_alloc = GET_ALLOC(HDRP(PREV_BLKP(bp)));
     size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
     size_t size = GET_SIZE(HDRP(bp));
@@ -287,6 +1099,8 @@ static void *coalesce(void *bp){
         remove_node(NEXT_BLKP(bp));
         if (rover == NEXT_BLKP(bp))
             rover = bp;
+        if (compact_cur == NEXT_BLKP(bp)) // compaction 커서도 rover처럼 사라지는 블록을 가리키면 옮겨 줌
+            compact_cur = bp;
 
         size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
         SET_HEADER(bp,size,0);
@@ -295,6 +1109,8 @@ static void *coalesce(void *bp){
         remove_node(PREV_BLKP(bp));
         if (rover == PREV_BLKP(bp))
             rover = bp;
+        if (compact_cur == bp)
+            compact_cur = PREV_BLKP(bp);
 
         size += GET_SIZE(HDRP(PREV_BLKP(bp)));
         bp = PREV_BLKP(bp);
@@ -308,6 +1124,8 @@ static void *coalesce(void *bp){
         remove_node(NEXT_BLKP(bp));
         if (rover == NEXT_BLKP(bp))
             rover = bp;
+        if (compact_cur == NEXT_BLKP(bp) || compact_cur == bp)
+            compact_cur = PREV_BLKP(bp);
 
         size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(HDRP(NEXT_BLKP(bp)));
         bp = PREV_BLKP(bp);
@@ -315,75 +1133,859 @@ static void *coalesce(void *bp){
         SET_FOOTER(bp, size, 0);
     }
 
+    coalesce_hist[!next_alloc + 2 * !prev_alloc]++;
+    EVENT(MM_EV_COALESCE, size, bp, 0, 1 + !next_alloc + 2 * !prev_alloc); // 위의 케이스 번호
+    PROBE(coalesce, bp, size, 1 + !next_alloc + 2 * !prev_alloc);
+    PHASE_STOP(MM_PHASE_COALESCE, pt);
     return bp;
 }
 
-void mm_free(void *bp){
-    size_t size = GET_SIZE((HDRP(bp)));
-
-    SET_HEADER(bp, size, 0);
-    SET_FOOTER(bp, size, 0);
+/* ========================== 수명 예측 & nursery =============================== */
 
-    bp = coalesce(bp);
+/**
+ * nursery 객체 형식: [birth][header: asize | NURSERY_BIT | 1][payload ...]
+ * - birth에는 할당 시점의 life_clock. free 때 실제 수명을 재서 예측기를 학습시킴
+ * - nursery 객체에는 footer가 없고 coalesce도 없음. 살아있는 객체 수만 세다가
+ *   0이 되면 bump pointer를 처음으로 되돌려 영역 전체를 한 번에 회수
+ */
+#define IS_NURSERY(bp) (GET(HDRP(bp)) & NURSERY_BIT)
+#define BIRTHP(bp)     ((char *)(bp) - DSIZE)
 
-    insert_node(bp);
+/**
+ * life_learn: 크기 bucket에서 관측한 수명으로 예측기 학습 + 정확도 집계
+ */
+static void life_learn(unsigned bucket, int predicted_short, size_t birth) {
+    int was_short = (life_clock - birth) <= LIFE_SHORT;
+
+    if (was_short && life_hist[bucket] < 3)
+        life_hist[bucket]++;
+    else if (!was_short && life_hist[bucket] > 0)
+        life_hist[bucket]--;
+
+    if (predicted_short)
+        was_short ? life_stats.short_right++ : life_stats.short_wrong++;
+    else
+        was_short ? life_stats.long_wrong++ : life_stats.long_right++;
 }
 
-static void *extend_heap(size_t words){
-    char* bp;
-    size_t size;
+/**
+ * nursery_alloc: nursery에서 bump pointer로 할당. 자리가 없으면 NULL
+ */
+static void *nursery_alloc(size_t size) {
+    size_t need = DSIZE + ALIGN(size); // birth + header + payload
+    char *bp;
 
-    size = (words%2) ? (words+1) * WSIZE : words*WSIZE;
-    if ((long)(bp=mem_sbrk(size)) == -1)
+    if (nursery_lo == NULL) { // 처음 쓸 때 힙에서 영역을 떼어 옴
+        if ((nursery_lo = heap_malloc(adjust_block(NURSERY_SIZE))) == NULL)
+            return NULL;
+        nursery_top = nursery_lo;
+        nursery_end = nursery_lo + NURSERY_SIZE;
+    }
+    if (nursery_top + need > nursery_end)
         return NULL;
 
-    // 힙을 확장한 후, 새 블록의 헤더/푸터 초기화
-    PUT(HDRP(bp), PACK(size, 0));         /* block header 해제 */
-    PUT(FTRP(bp), PACK(size, 0));         /* block footer 해제 */
-    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* 새로운 epilogue header */
+    bp = nursery_top + DSIZE;
+    PUT(BIRTHP(bp), life_clock);
+    PUT(HDRP(bp), PACK(need, NURSERY_BIT | 1));
+    nursery_top += need;
+    nursery_live++;
+    life_stats.nursery_allocs++;
+    return bp;
+}
 
-    // 이전 블록이 free이면 병합
-    return coalesce(bp);
+/**
+ * nursery_free: nursery 객체 해제. 마지막 객체였으면 영역 전체를 회수
+ */
+static void nursery_free(void *bp) {
+    size_t asize = adjust_block(GET_SIZE(HDRP(bp)) - DSIZE); // 할당 때와 같은 bucket을 얻도록 보정
+
+    life_learn(MIN(asize, NURSERY_MAX_OBJ) / 8, 1, GET(BIRTHP(bp)));
+    PUT(HDRP(bp), 0); // 이중 free 방지용으로 표시 지움
+    if (--nursery_live == 0) {
+        nursery_top = nursery_lo;
+        life_stats.nursery_resets++;
+    }
 }
 
-/* 메모리 관리자 초기화 */
-int mm_init(void){
-    /* 빈 힙 생성 */
-    if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
-        return -1;
+/**
+ * life_predict_alloc: 크기 이력으로 단명 여부를 예측해서, 단명이면 nursery에서 할당.
+ * 힙으로 가야 하면 NULL. 힙으로 간 블록은 life_track_alloc으로 표본 추적
+ */
+static void *life_predict_alloc(size_t size, size_t asize, int *predicted_short, unsigned *bucket) {
+    life_clock++;
+    *predicted_short = 0;
+    *bucket = MIN(asize, NURSERY_MAX_OBJ) / 8;
+    if (asize > NURSERY_MAX_OBJ)
+        return NULL;
 
-    PUT(heap_listp, 0);                            /* 정렬 패딩 */
-    PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1)); /* 프롤로그 헤더 */
-    PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1)); /* 프롤로그 푸터 */
-    PUT(heap_listp + (3 * WSIZE), PACK(0, 1));     /* 에필로그 헤더 */
-    heap_listp += (2 * WSIZE);
+    *predicted_short = life_hist[*bucket] >= 2;
+    return *predicted_short ? nursery_alloc(size) : NULL;
+}
 
-    /* CHUNKSIZE에 맞추어 빈 힙을 확장 */
-    if (extend_heap(CHUNKSIZE / WSIZE) == NULL)
-        return -1;
+/**
+ * life_track_alloc / life_track_free: 힙 블록 수명을 표본으로 재는 direct-mapped 테이블
+ * - 칸이 겹치면 새 블록이 덮어씀 (그 블록의 수명은 관측 못한 것으로 침)
+ */
+static inline unsigned life_slot(void *bp) {
+    return ((uintptr_t)bp / DSIZE) & (LIFE_TRACK - 1);
+}
 
-    // 설명 필요.
-    if (extend_heap(4)==NULL)
-        return -1;
+static void life_track_alloc(void *bp, unsigned bucket, int predicted_short) {
+    unsigned i = life_slot(bp);
+
+    life_track[i].bp = bp;
+    life_track[i].birth = life_clock;
+    life_track[i].bucket = bucket;
+    life_track[i].predicted_short = predicted_short;
+}
 
+static void life_track_free(void *bp) {
+    unsigned i = life_slot(bp);
 
-    rover = free_list_head;  // 힙 확장 후 첫 free 블록을 rover로 설정
+    life_clock++;
+    if (life_track[i].bp != bp)
+        return;
+    life_learn(life_track[i].bucket, life_track[i].predicted_short, life_track[i].birth);
+    life_track[i].bp = NULL;
+}
 
+/**
+ * mm_set_nursery: 수명 예측기 & nursery 켜기/끄기. 다음 mm_init부터 적용됨. MM_SHARED에서 켜려 하면 -1
+ */
+int mm_set_nursery(int enable) {
+#ifdef MM_SHARED
+    if (enable)
+        return -1; // 공유 힙에서는 nursery를 안 씀 (mm_init 참고)
+#endif
+    nursery_request = enable;
     return 0;
 }
 
 /**
- * mm_realloc (개선판): 새 블록 할당하고 이전 껀 해제
- *          - minmooo-ya 버전 
+ * mm_lifetime_stats: 현재 힙(마지막 mm_init 이후)의 예측 정확도 통계
  */
-void *mm_realloc(void *ptr, size_t size) {
+void mm_lifetime_stats(mm_lifetime_stats_t *st) {
+    LOCK();
+    *st = life_stats;
+    UNLOCK();
+}
+
+/* ========================== End of 수명 예측 & nursery =============================== */
+
+/* ========================== 지연 free & 백그라운드 coalescing =============================== */
+
+/**
+ * pending 블록 형식: [header: 할당 상태 그대로][다음 pending 블록][free된 시각 (ns 하위 32비트)] ...
+ * - 헤더는 할당 상태로 남겨 두므로, 큐에 있는 동안 이웃의 coalesce가 이 블록을 건드리지 않음
+ * - mm_free는 락 없이 CAS로 push만 함. 꺼낼 때는 락을 잡은 쪽이 exchange로 큐 전체를 가져가므로
+ *   pop 경쟁이 없어서 ABA 문제도 없음
+ */
+#define PEND_NEXT(bp) (*(void **)(bp))
+#define PEND_TIME(bp) (*(uint32_t *)((char *)(bp) + PTR_SIZE))
+
+static inline uint32_t now_ns32(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+/**
+ * defer_free: 블록을 pending 큐에 넣음 (락 없음)
+ */
+static void defer_free(void *bp) {
+    void *old = __atomic_load_n(&pending_head, __ATOMIC_RELAXED);
+
+    PEND_TIME(bp) = now_ns32();
+    do {
+        PEND_NEXT(bp) = old;
+    } while (!__atomic_compare_exchange_n(&pending_head, &old, bp, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&pending_pushed, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * drain_pending: pending 큐를 통째로 가져와 coalesce 후 free list에 넣음. 힙 락을 잡은 상태에서 호출
+ * - fg: malloc이 메모리가 모자라서 직접 비우는 경우 1, 백그라운드 스레드면 0
+ * - 처리한 블록 수를 반환
+ */
+static size_t drain_pending(int fg) {
+    void *bp = __atomic_exchange_n(&pending_head, NULL, __ATOMIC_ACQUIRE);
+    uint32_t now = now_ns32();
+    size_t n = 0;
+
+    while (bp != NULL) {
+        void *next = PEND_NEXT(bp);
+        uint32_t lag = now - PEND_TIME(bp); // 32비트 wrap이어도 차이는 맞음 (4초 미만이면)
+
+        lag_sum_ns += lag;
+        lag_max_ns = MAX(lag_max_ns, lag);
+        free_block(bp); // 헤더는 아직 할당 상태. 카운터, 프로파일 샘플 정리까지 mm_free와 같은 경로로
+        bp = next;
+        n++;
+    }
+
+    if (fg) {
+        drained_fg += n;
+        fg_drains += (n > 0);
+    } else {
+        drained_bg += n;
+    }
+    return n;
+}
+
+#ifdef MM_THREADS
+/**
+ * drain_main: 백그라운드 스레드. DRAIN_INTERVAL_NS마다 락을 잡고 pending 큐를 비움
+ */
+static void *drain_main(void *arg) {
+    struct timespec ts = {0, DRAIN_INTERVAL_NS};
+
+    (void)arg;
+    for (;;) {
+        nanosleep(&ts, NULL);
+        LOCK();
+        if (deferred_on)
+            drain_pending(0);
+        UNLOCK();
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * mm_set_deferred_free: 지연 free 켜기/끄기. 다음 mm_init부터 적용. MM_THREADS 빌드에서만 켤 수 있음
+ */
+int mm_set_deferred_free(int enable) {
+#if defined(MM_THREADS) && !defined(MM_SHARED) // 공유 힙에서는 pending 큐의 절대 포인터를 못 씀
+    deferred_request = enable;
+    return 0;
+#else
+    return enable ? -1 : 0;
+#endif
+}
+
+/**
+ * mm_deferred_stats: 현재 힙(마지막 mm_init 이후)의 지연 free 통계
+ */
+void mm_deferred_stats(mm_deferred_stats_t *st) {
+    LOCK();
+    st->deferred = __atomic_load_n(&pending_pushed, __ATOMIC_RELAXED);
+    st->drained_bg = drained_bg;
+    st->drained_fg = drained_fg;
+    st->fg_drains = fg_drains;
+    st->lag_avg_us = (drained_bg + drained_fg) ? lag_sum_ns / 1e3 / (drained_bg + drained_fg) : 0;
+    st->lag_max_us = lag_max_ns / 1e3;
+    UNLOCK();
+}
+
+/* ========================== End of 지연 free & 백그라운드 coalescing =============================== */
+
+/**
+ * free_block: 블록을 바로 해제하고 coalesce. 공개 함수 mm_free는 락을 잡거나 pending 큐로 보냄
+ */
+static void free_block(void *bp){
+    if (prof_nlive)
+        prof_forget(bp);
+
+    if (nursery_on) {
+        if (IS_NURSERY(bp)) {
+            life_clock++;
+            nursery_free(bp);
+            return;
+        }
+        life_track_free(bp);
+    }
+
+    size_t size = GET_SIZE((HDRP(bp)));
+    live_blocks--;
+
+    SET_HEADER(bp, size, 0);
+    SET_FOOTER(bp, size, 0);
+
+    bp = coalesce(bp);
+
+    insert_node(bp);
+}
+
+static void *extend_heap(size_t words){
+    char* bp;
+    size_t size;
+    uint64_t pt = PHASE_START();
+
+    size = (words%2) ? (words+1) * WSIZE : words*WSIZE;
+    if (size > INT_MAX) // mem_sbrk는 int로 받음. 잘린 크기로 늘려 놓고 원래 크기로 헤더를 쓰면 힙 밖을 씀
+        return NULL;
+    if ((long)(bp=mem_sbrk(size)) == -1)
+        return NULL;
+    extend_calls++;
+
+    // 힙을 확장한 후, 새 블록의 헤더/푸터 초기화
+    PUT(HDRP(bp), PACK(size, 0));         /* block header 해제 */
+    PUT(FTRP(bp), PACK(size, 0));         /* block footer 해제 */
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* 새로운 epilogue header */
+    EVENT(MM_EV_GROW, size, bp, 0, 0);
+    PROBE(extend_heap, bp, size);
+    PHASE_STOP(MM_PHASE_EXTEND, pt);
+
+    // 이전 블록이 free이면 병합
+    return coalesce(bp);
+}
+
+/**
+ * heap_tail: 에필로그 바로 앞 블록(힙의 마지막 블록)의 bp. 블록이 하나도 없으면 프롤로그
+ */
+static inline void *heap_tail(void) {
+    char *end = (char *)mem_heap_hi() + 1; // 에필로그 헤더 바로 뒤. 에필로그를 bp로 보는 셈
+    return PREV_BLKP(end);
+}
+
+/**
+ * grow_heap: asize 이상의 free 블록이 힙 끝에 생기도록 확장하고, free list에 넣어 돌려줌
+ * - 꼬리 블록이 free면 그 블록과 합쳐질 테니 부족분만 확장
+ * - 꼬리 블록이 할당 상태면 grow_chunk만큼 확장. grow_chunk는 확장이 잦으면 키우고
+ *   뜸하면 줄이며, CHUNKSIZE ~ GROW_CHUNK_MAX 사이로 제한
+ */
+static void *grow_heap(size_t asize) {
+    void *tail = heap_tail();
+    size_t gap = malloc_count - grow_last;
+    size_t extendsize;
+    void *bp;
+
+    if (gap < GROW_FAST)
+        grow_chunk = MIN(grow_chunk * 2, GROW_CHUNK_MAX);
+    else if (gap > GROW_SLOW)
+        grow_chunk = MAX(grow_chunk / 2, CHUNKSIZE);
+    grow_last = malloc_count;
+
+    if (!GET_ALLOC(HDRP(tail)))
+        extendsize = asize - MIN(asize, GET_SIZE(HDRP(tail)));
+    else
+        extendsize = MAX(asize, MIN(grow_chunk, MAX(mem_heapsize() >> GROW_HEAP_SHIFT, CHUNKSIZE)));
+
+    if (extendsize == 0) // 꼬리 free 블록이 이미 충분 (find_fit이 못 본 경우)
+        return tail;
+
+    if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+        return NULL;
+
+    insert_node(bp); // 새 free 블록 bp를 리스트에 넣어야만 place/remove_node가 정상 동작함!
+    return bp;
+}
+
+/* ========================== 핸들 & compaction =============================== */
+
+/**
+ * 핸들 블록 형식: [header: size | MOVABLE_BIT | 1][슬롯 번호][패딩][사용자 데이터 ...][footer]
+ * - 사용자는 블록 주소 대신 핸들(슬롯 테이블의 번호)을 들고 있고, mm_hlock으로 그때그때 주소를 얻음
+ * - 블록이 옮겨지면 payload 첫 워드의 슬롯 번호로 슬롯을 찾아 주소를 고침
+ * - 슬롯 테이블도 힙의 핸들 블록 하나라서 같이 옮겨질 수 있음 (슬롯 번호 자리에 HSLOT_TABLE,
+ *   주소는 hslot_tab에). 테이블이 고정 블록이면 그 자리에서 빈 공간이 막혀 brk를 못 줄임
+ * - 0번 슬롯은 쓰지 않음. 핸들 0은 "없음" (malloc의 NULL 역할)
+ */
+#define IS_MOVABLE(bp) (GET(HDRP(bp)) & MOVABLE_BIT)
+#define HBACK(bp)      (*(WTYPE *)(bp))        // 핸들 블록 payload 첫 워드: 슬롯 번호
+#define HPAYLOAD(bp)   ((char *)(bp) + DSIZE) // 정렬 유지를 위해 슬롯 번호 자리를 DSIZE로 잡음
+#define HSLOT_TABLE    ((WTYPE)-1)            // 슬롯 테이블 블록의 슬롯 번호
+#define HSLOT(i)       ((struct mm_hslot *)HPAYLOAD(hslot_tab.bp) + (i))
+
+static inline struct mm_hslot *hslot_of(void *bp) {
+    return HBACK(bp) == HSLOT_TABLE ? &hslot_tab : HSLOT(HBACK(bp));
+}
+
+#ifndef MM_SHARED // 공유 힙에서는 halloc_block이 항상 실패하니 슬롯을 늘릴 일이 없음
+/**
+ * hslot_grow: 슬롯 테이블을 2배 크기의 새 블록으로 옮기고 늘어난 슬롯을 빈 슬롯 리스트에 넣음
+ */
+static int hslot_grow(void) {
+    size_t cap = hslot_cap ? 2 * hslot_cap : HSLOT_INIT;
+    void *bp = heap_malloc(adjust_block(DSIZE + cap * sizeof(struct mm_hslot)));
+
+    if (bp == NULL)
+        return -1;
+    if (hslot_tab.bp != NULL) {
+        memcpy(HPAYLOAD(bp), HPAYLOAD(hslot_tab.bp), hslot_cap * sizeof(struct mm_hslot));
+        free_block(hslot_tab.bp);
+    }
+    PUT(HDRP(bp), GET(HDRP(bp)) | MOVABLE_BIT);
+    HBACK(bp) = HSLOT_TABLE;
+    hslot_tab.bp = bp;
+
+    for (size_t i = cap - 1; i >= MAX(hslot_cap, 1); i--) {
+        HSLOT(i)->bp = NULL;
+        HSLOT(i)->lock = hslot_free;
+        hslot_free = i;
+    }
+    hslot_cap = cap;
+    return 0;
+}
+#endif
+
+/**
+ * halloc_block: 움직일 수 있는 size 바이트 블록을 할당하고 핸들을 반환 (실패하면 0). nursery는 거치지 않음
+ */
+static mm_handle_t halloc_block(size_t size) {
+#ifdef MM_SHARED
+    (void)size;
+    return 0; // 슬롯 테이블과 compaction 커서가 프로세스 로컬이라 공유 힙에서는 지원 안 함
+#else
+    size_t i;
+    void *bp;
+
+    if (size == 0 || (hslot_free == 0 && hslot_grow() < 0))
+        return 0;
+    if ((bp = heap_malloc(adjust_block(size + DSIZE))) == NULL)
+        return 0;
+
+    i = hslot_free;
+    hslot_free = HSLOT(i)->lock;
+    PUT(HDRP(bp), GET(HDRP(bp)) | MOVABLE_BIT);
+    HBACK(bp) = i;
+    HSLOT(i)->bp = bp;
+    HSLOT(i)->lock = 0;
+    return i;
+#endif
+}
+
+/**
+ * hfree_block: 핸들 블록 해제 + 슬롯 반납
+ */
+static void hfree_block(mm_handle_t h) {
+    if (h == 0)
+        return;
+    free_block(HSLOT(h)->bp); // 헤더를 새로 쓰면서 MOVABLE_BIT도 지워짐
+    HSLOT(h)->bp = NULL;
+    HSLOT(h)->lock = hslot_free;
+    hslot_free = h;
+}
+
+#ifndef MM_SHARED // mm_compact가 바로 0을 돌려주므로 compaction 본체는 빠짐
+/**
+ * slide_down: free 블록 f 바로 뒤의 핸들 블록 b를 f 자리로 당기고, 핸들을 고침.
+ * f만큼의 빈 공간은 b 뒤로 넘어가서 그 뒤 free 블록과 합쳐짐. 그 free 블록의 bp를 반환
+ */
+static void *slide_down(void *f, void *b) {
+    size_t fsize = GET_SIZE(HDRP(f));
+    size_t bsize = GET_SIZE(HDRP(b));
+    void *rest;
+
+    remove_node(f); // f의 pred/succ는 곧 덮어써지니 먼저 리스트에서 뺌
+    memmove(HDRP(f), HDRP(b), bsize); // 헤더부터 푸터까지 통째로. 겹칠 수 있으니 memmove
+    hslot_of(f)->bp = f;
+
+    rest = (char *)f + bsize;
+    SET_HEADER(rest, fsize, 0);
+    SET_FOOTER(rest, fsize, 0);
+    rest = coalesce(rest);
+    insert_node(rest);
+    return rest;
+}
+
+/**
+ * fill_hole: free 블록 f 바로 뒤가 고정 블록이라 당길 수 없을 때, 뒤쪽 COMPACT_LOOKAHEAD 블록 안에서
+ * f에 들어가는 핸들 블록을 찾아 f로 옮김. 못 찾으면 NULL, 옮겼으면 f 다음에 이어서 볼 블록의 bp
+ * - 딱 맞거나 남는 공간이 MIN_BLOCK_SIZE 이상이어야 함 (남는 공간은 free 블록으로)
+ */
+static void *fill_hole(void *f) {
+    size_t fsize = GET_SIZE(HDRP(f));
+    char *b = NEXT_BLKP(f);
+    size_t bsize;
+    void *rest;
+
+    for (int i = 0; ; i++) {
+        if (i >= COMPACT_LOOKAHEAD || GET_SIZE(HDRP(b)) == 0)
+            return NULL;
+        bsize = GET_SIZE(HDRP(b));
+        if (IS_MOVABLE(b) && !hslot_of(b)->lock &&
+            (bsize == fsize || (bsize < fsize && fsize - bsize >= MIN_BLOCK_SIZE)))
+            break;
+        b = NEXT_BLKP(b);
+    }
+
+    remove_node(f);
+    memcpy(HDRP(f), HDRP(b), bsize); // b는 f보다 뒤에 있고 겹치지 않음
+    hslot_of(f)->bp = f;
+
+    rest = (char *)f + bsize;
+    if (fsize > bsize) { // f 뒤는 할당 블록이니 남는 공간은 병합 없이 그대로 free
+        SET_HEADER(rest, fsize - bsize, 0);
+        SET_FOOTER(rest, fsize - bsize, 0);
+        insert_node(rest);
+    }
+
+    SET_HEADER(b, bsize, 0); // 원래 자리는 해제
+    SET_FOOTER(b, bsize, 0);
+    insert_node(coalesce(b));
+    return rest;
+}
+
+/**
+ * trim_heap: 꼬리 블록이 free면 그만큼 brk를 줄여 힙을 돌려줌
+ */
+static void trim_heap(void) {
+    void *tail = heap_tail();
+    size_t size = GET_SIZE(HDRP(tail));
+
+    if (GET_ALLOC(HDRP(tail)))
+        return;
+    remove_node(tail);
+    PUT(HDRP(tail), PACK(0, 1)); // 꼬리 블록 헤더 자리가 새 에필로그
+    mem_sbrk(-(int)size);
+}
+
+/**
+ * compact_heap: 잠기지 않은 핸들 블록을 힙 아래쪽(mem_heap_lo() 쪽)으로 밀어 모음 (sliding compaction)
+ * - 힙을 앞에서부터 걸으면서 "free 블록 바로 뒤에 잠기지 않은 핸들 블록"이 보이면 당겨 옴.
+ *   빈 공간이 계속 뒤로 밀려 가다가 고정 블록을 만나면, fill_hole로 뒤쪽 핸들 블록을 끌어와 채워 봄
+ * - budget > 0이면 대략 budget 바이트를 옮긴 뒤 멈추고, 다음 호출은 compact_cur부터 이어 감
+ * - budget == 0이면 이번 pass를 끝까지
+ * - pass가 에필로그에 닿으면 꼬리 free 블록만큼 brk를 줄이고 커서를 처음으로
+ * - 옮긴 바이트 수를 반환
+ */
+static size_t compact_heap(size_t budget) {
+    size_t moved = 0;
+    char *bp = compact_cur ? compact_cur : NEXT_BLKP(heap_listp);
+
+    while (GET_SIZE(HDRP(bp)) > 0) {
+        char *next = NEXT_BLKP(bp);
+        char *filled;
+
+        if (GET_ALLOC(HDRP(bp))) {
+            bp = next;
+            continue;
+        }
+        if (budget && moved >= budget)
+            break;
+        if (GET_SIZE(HDRP(next)) > 0 && IS_MOVABLE(next) && !hslot_of(next)->lock) {
+            moved += GET_SIZE(HDRP(next));
+            bp = slide_down(bp, next);
+        } else if ((filled = fill_hole(bp)) != NULL) {
+            moved += filled - bp;
+            bp = filled;
+        } else {
+            bp = next;
+        }
+    }
+
+    if (GET_SIZE(HDRP(bp)) == 0) { // pass 끝
+        trim_heap();
+        compact_cur = NULL;
+    } else {
+        compact_cur = bp;
+    }
+    return moved;
+}
+#endif
+
+/* ========================== End of 핸들 & compaction =============================== */
+
+/* ========================== 힙 프로파일러 =============================== */
+
+/**
+ * 샘플링 힙 프로파일러
+ * - 요청 바이트 기준으로 평균 prof_period 바이트마다 malloc 하나를 샘플링. 샘플 사이 간격은 지수분포에서 뽑아서
+ *   (바이트마다 같은 확률로 뽑는 것과 같음) 할당 패턴의 주기와 맞물리지 않고, pprof이 크기별 확률로 역산할 수 있음
+ * - malloc_block은 prof_countdown에서 요청 크기를 빼고 부호만 봄. 샘플을 안 뜨는 malloc의 비용은 이게 전부
+ * - 샘플은 backtrace와 크기를 스택 버킷(prof_stacks)에 더하고, bp → (버킷, 크기)를 prof_live에 넣어 둠.
+ *   free_block은 살아있는 샘플이 있을 때만 prof_live를 찾아봄
+ * - 테이블은 전부 정적 배열이라 프로파일러는 다른 할당자를 부르지 않음 (backtrace가 처음에 libgcc를 올릴 때 빼고)
+ */
+
+/**
+ * prof_next: 다음 샘플까지의 간격. -ln(u) * 평균, u는 (0, 1] 균등분포
+ */
+static int64_t prof_next(void) {
+    double u, gap;
+
+    if (prof_period == 0)
+        return INT64_MAX;
+    prof_rng ^= prof_rng << 13;
+    prof_rng ^= prof_rng >> 7;
+    prof_rng ^= prof_rng << 17;
+    u = ((prof_rng >> 11) + 1) * (1.0 / 9007199254740992.0); // 상위 53비트 / 2^53
+    gap = -log(u) * prof_period;
+    return gap >= 4e18 ? INT64_MAX : (int64_t)gap + 1;
+}
+
+static inline size_t prof_slot(void *bp) {
+    return (size_t)(((uint64_t)(uintptr_t)bp / DSIZE * 0x9E3779B97F4A7C15ull) >> (64 - PROF_LIVE_BITS));
+}
+
+/**
+ * prof_sample: countdown이 0 아래로 내려간 malloc. 간격을 새로 뽑고, 블록이 있으면 스택과 크기를 기록.
+ * 스택은 이 함수를 부른 곳(할당자 안)부터 시작함
+ */
+static __attribute__((noinline)) void prof_sample(void *bp, size_t size) {
+    void *pc[PROF_DEPTH + 1];
+    struct prof_stack *s, *end = prof_stacks + prof_nstacks;
+    uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+    size_t i, mask = (1 << PROF_LIVE_BITS) - 1;
+    int depth;
+
+    prof_countdown = prof_next();
+    if (bp == NULL || prof_period == 0)
+        return;
+
+    depth = backtrace(pc, PROF_DEPTH + 1) - 1; // pc[0]은 prof_sample 자신
+    if (depth < 0)
+        depth = 0;
+    for (i = 1; i <= (size_t)depth; i++)
+        hash = (hash ^ (uintptr_t)pc[i]) * 0x100000001b3ull;
+
+    for (s = prof_stacks; s < end; s++)
+        if (s->hash == hash && s->depth == depth && !memcmp(s->pc, pc + 1, depth * sizeof(void *)))
+            break;
+    if (s == end) {
+        if (prof_nstacks == PROF_STACKS)
+            return;
+        prof_nstacks++;
+        s->hash = hash;
+        s->depth = depth;
+        memcpy(s->pc, pc + 1, depth * sizeof(void *));
+        s->live_objs = s->live_bytes = s->alloc_objs = s->alloc_bytes = 0;
+    }
+    s->alloc_objs++;
+    s->alloc_bytes += size;
+
+    if (prof_nlive >= (mask + 1) / 2) // 살아있는 샘플이 너무 많으면 누적 프로파일에만 남김
+        return;
+    s->live_objs++;
+    s->live_bytes += size;
+    for (i = prof_slot(bp); prof_live[i].bp != NULL; i = (i + 1) & mask)
+        ;
+    prof_live[i].bp = bp;
+    prof_live[i].size = size;
+    prof_live[i].stack = s;
+    prof_nlive++;
+}
+
+/**
+ * prof_forget: free되는 블록이 샘플이었으면 live 쪽에서 뺌.
+ * 지운 칸 뒤로 이어진 샘플들은 제자리에서 찾을 수 있게 당겨 옴 (linear probing의 backward shift 삭제)
+ */
+static void prof_forget(void *bp) {
+    size_t mask = (1 << PROF_LIVE_BITS) - 1, i, j;
+
+    for (i = prof_slot(bp); prof_live[i].bp != bp; i = (i + 1) & mask)
+        if (prof_live[i].bp == NULL)
+            return; // 샘플 안 된 블록
+    prof_live[i].stack->live_objs--;
+    prof_live[i].stack->live_bytes -= prof_live[i].size;
+    prof_nlive--;
+
+    for (j = (i + 1) & mask; prof_live[j].bp != NULL; j = (j + 1) & mask) {
+        size_t home = prof_slot(prof_live[j].bp);
+
+        if (((j - home) & mask) >= ((j - i) & mask)) { // 빈 칸 i가 home과 j 사이에 있으면 i로 옮겨도 찾아짐
+            prof_live[i] = prof_live[j];
+            i = j;
+        }
+    }
+    prof_live[i].bp = NULL;
+}
+
+static void prof_init(void) {
+#ifdef MM_SHARED
+    prof_period = 0; // 샘플 테이블이 프로세스 메모리에 있어서 공유 힙에서는 끔
+#else
+    prof_period = prof_request;
+#endif
+    prof_rng = 0x9E3779B97F4A7C15ull; // 고정 시드: 같은 트레이스면 같은 블록이 샘플됨
+    prof_countdown = prof_next();
+    prof_nstacks = 0;
+    if (prof_nlive) {
+        memset(prof_live, 0, sizeof(prof_live));
+        prof_nlive = 0;
+    }
+}
+
+/**
+ * mm_set_heap_sampling: 평균 bytes 바이트마다 샘플링. 0이면 끔. 다음 mm_init부터 적용됨
+ */
+int mm_set_heap_sampling(size_t bytes) {
+#ifdef MM_SHARED
+    if (bytes)
+        return -1;
+#endif
+    prof_request = bytes;
+    return 0;
+}
+
+/**
+ * mm_heap_profile: 샘플들을 스택별로 묶어서 gperftools 힙 프로파일 텍스트 형식(heap_v2)으로 씀.
+ * 한 줄이 "live 개수: live 바이트 [누적 개수: 누적 바이트] @ pc...". pprof이 주소를 심볼로 바꿀 수 있게
+ * 끝에 /proc/self/maps를 붙임. 샘플링이 꺼져 있으면 -1
+ */
+int mm_heap_profile(FILE *fp) {
+    size_t live_objs = 0, live_bytes = 0, alloc_objs = 0, alloc_bytes = 0, n;
+    struct prof_stack *s;
+    char buf[4096];
+    FILE *maps;
+    int i;
+
+    LOCK();
+    if (prof_period == 0) {
+        UNLOCK();
+        return -1;
+    }
+    if (deferred_on)
+        drain_pending(0); // 큐에 남은 지연 free도 free_block을 거쳐 prof_forget되게 먼저 비움
+    for (s = prof_stacks; s < prof_stacks + prof_nstacks; s++) {
+        live_objs += s->live_objs;
+        live_bytes += s->live_bytes;
+        alloc_objs += s->alloc_objs;
+        alloc_bytes += s->alloc_bytes;
+    }
+    fprintf(fp, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",
+            live_objs, live_bytes, alloc_objs, alloc_bytes, prof_period);
+    for (s = prof_stacks; s < prof_stacks + prof_nstacks; s++) {
+        fprintf(fp, "%zu: %zu [%zu: %zu] @", s->live_objs, s->live_bytes, s->alloc_objs, s->alloc_bytes);
+        for (i = 0; i < s->depth; i++)
+            fprintf(fp, " %#lx", (unsigned long)(uintptr_t)s->pc[i]);
+        fprintf(fp, "\n");
+    }
+    UNLOCK();
+
+    fprintf(fp, "\nMAPPED_LIBRARIES:\n");
+    if ((maps = fopen("/proc/self/maps", "r")) != NULL) {
+        while ((n = fread(buf, 1, sizeof(buf), maps)) > 0)
+            fwrite(buf, 1, n, fp);
+        fclose(maps);
+    }
+    return ferror(fp) ? -1 : 0;
+}
+
+/* ========================== End of 힙 프로파일러 =============================== */
+
+/* 메모리 관리자 초기화 */
+static int init_heap(void){
+    void *bp;
+
+    /* 이전 힙의 흔적 초기화 (mdriver는 트레이스마다 brk만 되돌리고 mm_init을 다시 부름) */
+    free_list_head = NULL;
+    rover = NULL;
+    free_bytes = 0;
+    grow_chunk = CHUNKSIZE;
+    malloc_count = 0;
+    grow_last = 0;
+#ifdef MM_SHARED
+    user_root = NULL;
+#endif
+
+    /* 수명 예측기 & nursery 초기화. 공유 힙에서는 nursery 포인터가 프로세스마다 달라서 끔 */
+#ifdef MM_SHARED
+    nursery_on = 0;
+#else
+    nursery_on = nursery_request;
+#endif
+    nursery_lo = nursery_top = nursery_end = NULL;
+    nursery_live = 0;
+    life_clock = 0;
+    memset(life_hist, 1, sizeof(life_hist)); // 처음엔 "약하게 장수"로 예측
+    memset(life_track, 0, sizeof(life_track));
+    memset(&life_stats, 0, sizeof(life_stats));
+
+    /* 핸들 & compaction 초기화 */
+    hslot_tab.bp = NULL;
+    hslot_tab.lock = 0;
+    hslot_cap = 0;
+    hslot_free = 0;
+    compact_cur = NULL;
+
+    /* 힙 프로파일러 초기화 */
+    prof_init();
+
+    /* 지연 free 초기화. 백그라운드 스레드는 처음 켤 때 한 번만 띄움 */
+    deferred_on = deferred_request;
+    pending_head = NULL;
+    pending_pushed = 0;
+    drained_bg = drained_fg = fg_drains = 0;
+    lag_sum_ns = lag_max_ns = 0;
+#ifdef MM_THREADS
+    if (deferred_on && !drain_started) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, drain_main, NULL) != 0)
+            return -1;
+        pthread_detach(tid);
+        drain_started = 1;
+    }
+#endif
+
+    /* 배치 정책 반영. adaptive는 best fit으로 시작 */
+    fit_policy = (fit_request == MM_FIT_ADAPTIVE) ? MM_FIT_BEST : fit_request;
+    win_fits = 0;
+    win_visits = 0;
+    fit_profile = fit_profile_request;
+    memset(&fit_stats, 0, sizeof(fit_stats));
+    phase_profile = phase_profile_request;
+    memset(&phase_stats, 0, sizeof(phase_stats));
+    live_blocks = 0;
+    extend_calls = 0;
+    memset(search_hist, 0, sizeof(search_hist));
+    memset(coalesce_hist, 0, sizeof(coalesce_hist));
+
+    /* 빈 힙 생성 */
+    if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
+        return -1;
+#ifdef MM_SIZE_INDEX
+    idx_init();
+#endif
+
+    PUT(heap_listp, 0);                            /* 정렬 패딩 */
+    PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1)); /* 프롤로그 헤더 */
+    PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1)); /* 프롤로그 푸터 */
+    PUT(heap_listp + (3 * WSIZE), PACK(0, 1));     /* 에필로그 헤더 */
+    heap_listp += (2 * WSIZE);
+
+    /* CHUNKSIZE에 맞추어 빈 힙을 확장 */
+    if ((bp = extend_heap(CHUNKSIZE / WSIZE)) == NULL)
+        return -1;
+    insert_node(bp); // 첫 free 블록도 리스트에 있어야 이후 coalesce의 remove_node가 정상 동작함
+
+    // 설명 필요.
+    if ((bp = extend_heap(4)) == NULL)
+        return -1;
+    insert_node(bp);
+
+
+    rover = free_list_head;  // 힙 확장 후 첫 free 블록을 rover로 설정
+
+    return 0;
+}
+
+/**
+ * copy_block: realloc이 블록을 옮길 때의 데이터 복사 (단계 측정 포함)
+ */
+static void copy_block(void *dst, void *src, size_t n) {
+    uint64_t pt = PHASE_START();
+
+    memcpy(dst, src, n);
+    if (phase_profile)
+        phase_stats.copy_bytes += n;
+    PHASE_STOP(MM_PHASE_COPY, pt);
+}
+
+/**
+ * realloc_block (개선판): 새 블록 할당하고 이전 껀 해제
+ *          - minmooo-ya 버전 
+ */
+static void *realloc_block(void *ptr, size_t size) {
     if (ptr == NULL)
-        return mm_malloc(size);  // ptr이 NULL이면 malloc과 같은 방식으로 처리
+        return malloc_block(size);  // ptr이 NULL이면 malloc과 같은 방식으로 처리
     if (size == 0) {
-        mm_free(ptr);  // size가 0이면 해당 블록을 free하고 NULL 반환
+        free_block(ptr);  // size가 0이면 해당 블록을 free하고 NULL 반환
         return NULL;
     }
 
+    if (nursery_on && IS_NURSERY(ptr)) { // nursery 객체는 제자리 확장이 없으니 새로 할당 후 복사
+        void *newptr = malloc_block(size);
+        size_t copySize = GET_SIZE(HDRP(ptr)) - DSIZE;
+        if (newptr == NULL)
+            return NULL;
+        copy_block(newptr, ptr, MIN(size, copySize));
+        free_block(ptr);
+        return newptr;
+    }
+
     size_t oldsize = GET_SIZE(HDRP(ptr));  // 기존 블록의 크기 가져오기
     size_t asize = adjust_block(size);
 
@@ -393,60 +1995,436 @@ void *mm_realloc(void *ptr, size_t size) {
     void *next = NEXT_BLKP(ptr);  // 다음 블록 주소
     if (!GET_ALLOC(HDRP(next)) && (oldsize + GET_SIZE(HDRP(next))) >= asize) {
         remove_node(next);  // 만약 옆 블록이 free이고 크기가 충분하면 병합
+        if (compact_cur == next)
+            compact_cur = ptr;
         size_t newsize = oldsize + GET_SIZE(HDRP(next));  // 병합 후 새로운 크기
         PUT(HDRP(ptr), PACK(newsize, 1));  // 헤더 업데이트
         PUT(FTRP(ptr), PACK(newsize, 1));  // 푸터 업데이트
         return ptr;  // 병합된 블록 반환
     }
 
-    void *newptr = mm_malloc(size);  // 병합할 수 없다면 새로운 메모리 할당
+    /* 힙의 마지막 블록이면 (바로 뒤가 에필로그이거나 free 꼬리 블록) 부족분만 힙을 늘려 제자리 확장 */
+    if (ptr == heap_tail() || (!GET_ALLOC(HDRP(next)) && next == heap_tail())) {
+        size_t avail = oldsize + (GET_ALLOC(HDRP(next)) ? 0 : GET_SIZE(HDRP(next)));
+        void *bp = extend_heap((asize - avail) / WSIZE); // 꼬리 free 블록이 있으면 coalesce가 리스트에서 빼고 합쳐 줌
+        if (bp == NULL)
+            return NULL;
+        if (compact_cur == bp)
+            compact_cur = ptr;
+        size_t newsize = oldsize + GET_SIZE(HDRP(bp));
+        PUT(HDRP(ptr), PACK(newsize, 1));
+        PUT(FTRP(ptr), PACK(newsize, 1));
+        return ptr;
+    }
+
+    void *newptr = malloc_block(size);  // 병합할 수 없다면 새로운 메모리 할당
     if (newptr == NULL)
         return NULL;  // 할당 실패하면 NULL 반환
 
     size_t copySize = oldsize - DSIZE;  // 기존 데이터 크기
     if (size < copySize)
         copySize = size;  // 복사할 크기를 요청된 크기로 맞춤
-    memcpy(newptr, ptr, copySize);  // 데이터 복사
-    mm_free(ptr);  // 기존 블록은 free
+    copy_block(newptr, ptr, copySize);  // 데이터 복사
+    free_block(ptr);  // 기존 블록은 free
     return newptr;  // 새로운 포인터 반환
 }
 
 
 /**
- * mm_malloc: 최소 size 바이트의 페이로드를 가진 블록 할당
+ * heap_malloc: 힙에서 asize(보정된 블록 크기) 블록을 할당. nursery를 거치지 않는 경로
+ */
+static void *heap_malloc(size_t asize){
+    malloc_count++;
+
+    /* free list에서 현재 배치 정책으로 탐색 */
+    void *bp = find_fit(asize);
+
+    /* 지연 free 중이면, 힙을 늘리기 전에 pending 큐를 직접 비워서 다시 찾아 봄 */
+    if (bp == NULL && deferred_on && drain_pending(1) > 0)
+        bp = find_fit(asize);
+
+    if (bp != NULL)
+        return place(bp, asize); // place 안에서 remove_node → split/insert_node
+
+    /* 적합 블록이 없으니 힙 확장 (꼬리 free 블록이 있으면 부족분만) */
+    bp = grow_heap(asize);   // bp는 free list에 들어간 free 블록
+
+    if (bp == NULL)
+        return NULL;
+
+    /* 이제 바로 할당 */
+    return place(bp, asize);
+}
+
+/**
+ * malloc_block: 최소 size 바이트의 페이로드를 가진 블록 할당
  * size가 0이면 NULL을 반환
  * asize는 헤더와 정렬 요구 사항을 포함한 조정된 블록 크기
- * extendsize는 적합한 블록이 없을 때 힙을 확장할 양
+ * 수명 예측기가 켜져 있으면 단명으로 예측된 요청은 nursery로 보냄
  */
-void *mm_malloc(size_t size){
+static void *malloc_block(size_t size){
+    void *bp;
+
     if (size == 0)
         return NULL;
 
     /* 1. 요청 크기 보정 */
     size_t asize = adjust_block(size);
 
-    /* 2. free list에서 first-fit 탐색 */
-    void *bp = find_fit(asize);
-    if (bp != NULL) {
-        place(bp, asize); // place 안에서 remove_node → split/insert_node
-        return bp;
+    /* 2. 단명 예측이면 nursery에서, 나머지는 힙에서 */
+    if (nursery_on) {
+        int predicted_short;
+        unsigned bucket;
+
+        bp = life_predict_alloc(size, asize, &predicted_short, &bucket);
+        if (bp == NULL && (bp = heap_malloc(asize)) != NULL && asize <= NURSERY_MAX_OBJ)
+            life_track_alloc(bp, bucket, predicted_short); // 예측 대상인 크기만 수명을 잼
+    } else {
+        bp = heap_malloc(asize);
     }
 
-    /* 3. 적합 블록이 없으니 힙 확장 */
-    size_t extendsize = MAX(asize, CHUNKSIZE);
-    bp = extend_heap(extendsize / WSIZE);   // bp는 free 블록
+    /* 3. 힙 프로파일 샘플링. 안 뜨는 경우는 뺄셈과 비교 하나 */
+    if ((prof_countdown -= (int64_t)size) < 0)
+        prof_sample(bp, size);
+    return bp;
+}
+
 
-    if (bp == NULL)
-        return NULL;
+/* ========================== 공유 힙 루트 & 영속 힙 =============================== */
+#ifdef MM_SHARED
 
-    insert_node(bp); // 새 free 블록 bp를 리스트에 넣어야만 place/remove_node가 정상 동작함!
+/**
+ * roots_load: 세그먼트 헤더의 루트(오프셋)를 이 프로세스의 포인터로 풀어서 전역 변수에 넣음.
+ * memlib이 공유 모드가 아니면 (mem_init으로 초기화) 그냥 프로세스 로컬 힙으로 동작
+ */
+static void roots_load(void) {
+    shm_roots_t *r = mem_shared_area();
+
+    heap_base = mem_heap_lo();
+    undo_roots = r;
+    if (r == NULL)
+        return;
+    roots_clean = r->clean;
+    r->clean = 0; // 락을 잡은 동안 죽으면 다음에 붙는 쪽이 검사하도록
+    heap_listp = FROM_OFF(r->heap_listp);
+    free_list_head = FROM_OFF(r->free_list_head);
+    rover = FROM_OFF(r->rover);
+    user_root = FROM_OFF(r->user_root);
+    free_bytes = r->free_bytes;
+    live_blocks = r->live_blocks;
+    grow_chunk = r->grow_chunk;
+    malloc_count = r->malloc_count;
+    grow_last = r->grow_last;
+    win_fits = r->win_fits;
+    win_visits = r->win_visits;
+    fit_policy = r->fit_policy;
+}
+
+/**
+ * roots_store: 전역 변수의 루트를 오프셋으로 바꿔 세그먼트 헤더에 씀
+ */
+static void roots_store(void) {
+    shm_roots_t *r = mem_shared_area();
+
+    if (r == NULL)
+        return;
+    r->heap_listp = TO_OFF(heap_listp);
+    r->free_list_head = TO_OFF(free_list_head);
+    r->rover = TO_OFF(rover);
+    r->user_root = TO_OFF(user_root);
+    r->free_bytes = free_bytes;
+    r->live_blocks = live_blocks;
+    r->grow_chunk = grow_chunk;
+    r->malloc_count = malloc_count;
+    r->grow_last = grow_last;
+    r->win_fits = win_fits;
+    r->win_visits = win_visits;
+    r->fit_policy = fit_policy;
+    r->heap_extent = mem_heapsize();
+    __atomic_signal_fence(__ATOMIC_SEQ_CST); // 루트를 다 쓴 뒤에 로그를 비워야 그 사이에 죽어도 되돌릴 수 있음
+    r->undo_n = 0;
+}
+
+/**
+ * undo_note: PUT이 p를 덮어쓰기 전에 원래 값을 undo 로그에 남김. 힙 밖(세그먼트 헤더 등)은 무시.
+ * 로그가 넘치면 undo_n만 UNDO_MAX+1로 두고, 그 연산은 되돌리지 못함 (heap_undo 참고)
+ */
+static void undo_note(void *p) {
+    shm_roots_t *r = undo_roots;
+    int n;
+
+    if (r == NULL || (char *)p < heap_base || (char *)p >= heap_base + mem_heapsize())
+        return;
+    if ((n = r->undo_n) < UNDO_MAX) {
+        r->undo[n].off = (char *)p - heap_base;
+        r->undo[n].old = *(WTYPE *)p;
+    }
+    __atomic_signal_fence(__ATOMIC_SEQ_CST); // 기록 → 개수 → 실제 쓰기 순서를 컴파일러가 바꾸지 않도록
+    if (n <= UNDO_MAX)
+        r->undo_n = n + 1;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
 
-    /* 4. 이제 바로 할당 */
-    place(bp, asize);
+/**
+ * heap_undo: 락을 잡은 채 죽은 연산이 남긴 쓰기를 거꾸로 되돌리고 brk도 마지막 UNLOCK 때 크기로 돌림.
+ * 그러면 힙은 마지막으로 루트를 쓴 시점 그대로라 루트와 맞음. 로그가 넘쳤으면 되돌리지 않고 -1
+ */
+static int heap_undo(shm_roots_t *r) {
+    size_t heapsize = mem_heapsize();
+    int n = r->undo_n;
+
+    if (n > UNDO_MAX)
+        return -1;
+    if (r->heap_extent != heapsize && (r->heap_extent > heapsize + INT_MAX || heapsize > r->heap_extent + INT_MAX ||
+                                       mem_sbrk((int)(r->heap_extent - heapsize)) == (void *)-1))
+        return -1;
+    while (n-- > 0)
+        if (r->undo[n].off + WSIZE <= r->heap_extent)
+            *(WTYPE *)(heap_base + r->undo[n].off) = r->undo[n].old;
+    r->undo_n = 0;
+    return 0;
+}
+
+/**
+ * heap_scan: 다시 붙은 힙의 블록 구조 검사 (mm_checkheap의 프롤로그/블록/에필로그 검사와 같은 기준).
+ * 블록을 따라가도 안전한지만 보고, free list는 어차피 다시 만드니 보지 않음. 오류 수를 반환
+ */
+static int heap_scan(void) {
+    char *lo = mem_heap_lo(), *hi = mem_heap_hi();
+    char *bp = heap_listp;
+    size_t limit = mem_heapsize() / MIN_BLOCK_SIZE + 1; // 블록 수의 상한 (순환 방지)
+
+    if (bp == NULL || bp < lo || bp > hi || GET_SIZE(HDRP(bp)) != DSIZE || !GET_ALLOC(HDRP(bp)))
+        return 1;
+    for (bp = NEXT_BLKP(bp); limit-- > 0; bp = NEXT_BLKP(bp)) {
+        size_t size;
+
+        if ((char *)HDRP(bp) > hi - WSIZE + 1)
+            return 1;
+        if ((size = GET_SIZE(HDRP(bp))) == 0)
+            break;
+        if (size < MIN_BLOCK_SIZE || ((uintptr_t)bp % DRIVER_ALIGN) ||
+            (char *)FTRP(bp) > hi - WSIZE + 1 ||
+            GET_SIZE(FTRP(bp)) != size || GET_ALLOC(FTRP(bp)) != GET_ALLOC(HDRP(bp)))
+            return 1;
+    }
+    /* 에필로그는 정확히 힙의 마지막 워드여야 함 */
+    return (limit == (size_t)-1 || (char *)HDRP(bp) != hi - WSIZE + 1 || !GET_ALLOC(HDRP(bp)));
+}
+
+/**
+ * heap_recover: 정상 종료 표시 없이 다시 붙은 힙을 검사하고, boundary tag를 기준으로 free list를 다시 만듦.
+ * 죽기 직전의 free list 링크나 병합 도중 상태는 믿지 않음. 이웃한 free 블록은 여기서 합침
+ */
+static int heap_recover(void) {
+    char *bp, *last_free = NULL;
+
+    if (heap_scan() != 0)
+        return -1;
+
+    free_list_head = NULL;
+    rover = NULL;
+    free_bytes = 0;
+    live_blocks = 0;
+    for (bp = NEXT_BLKP(heap_listp); GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+        if (GET_ALLOC(HDRP(bp))) {
+            live_blocks++;
+            last_free = NULL;
+            continue;
+        }
+        if (last_free != NULL) { // 바로 앞이 free: 합치고 합친 블록 끝에서 계속
+            size_t size = GET_SIZE(HDRP(last_free)) + GET_SIZE(HDRP(bp));
+            free_bytes += GET_SIZE(HDRP(bp));
+            SET_HEADER(last_free, size, 0);
+            SET_FOOTER(last_free, size, 0);
+            SET_NODE_SIZE(last_free, size); // 이미 리스트에 있는 노드
+            bp = last_free;
+            continue;
+        }
+        insert_node(bp);
+        last_free = bp;
+    }
+    rover = free_list_head;
+    CHKHEAP(__LINE__);
+    return 0;
+}
+
+#endif /* MM_SHARED */
+
+/* ========================== 공개 함수 =============================== */
+/* 내부 함수를 감싸기만 함. MM_THREADS/MM_SHARED 빌드면 힙 락을 잡고, 아니면 LOCK/UNLOCK은 빈 매크로 */
+
+/**
+ * mm_init: 공유/파일 힙에 이미 만들어 둔 힙이 있으면 초기화 없이 붙기만 함.
+ * 정상 종료 표시가 없거나 기록된 힙 크기가 brk와 다르면 heap_undo로 죽은 연산을 되돌리고 heap_recover로 검사 & free list 재구성
+ */
+int mm_init(void) {
+    int ret;
+
+    LOCK();
+    heap_recovered = 0;
+#ifdef MM_SHARED
+    shm_roots_t *r = mem_shared_area();
+
+    if (r != NULL && r->initialized && mem_heapsize() > 0) {
+        ret = 0;
+        if (!roots_clean || r->heap_extent != mem_heapsize()) {
+            heap_undo(r); // 넘쳤으면 못 되돌린 채로 검사. 깨졌으면 heap_scan이 거부
+            ret = heap_recover();
+            heap_recovered = 1;
+        }
+        UNLOCK();
+        return ret;
+    }
+    ret = init_heap();
+    if (r != NULL)
+        r->initialized = (ret == 0);
+#else
+    ret = init_heap();
+#endif
+    UNLOCK();
+    return ret;
+}
+
+/**
+ * mm_shutdown: 정상 종료 표시를 남기고 파일 힙을 디스크에 내림. 다음 mm_init은 검사 없이 바로 붙음
+ */
+void mm_shutdown(void) {
+#ifdef MM_SHARED
+    shm_roots_t *r = mem_shared_area();
+
+    if (r != NULL) {
+        mem_shared_lock(); // 루트는 마지막 UNLOCK 때 이미 써 둠. 표시만 바꿈
+        r->clean = 1;
+        mem_shared_unlock();
+    }
+#endif
+    mem_sync();
+}
+
+/**
+ * mm_was_recovered: 마지막 mm_init이 힙 검사 & free list 재구성을 했으면 1
+ */
+int mm_was_recovered(void) {
+    return heap_recovered;
+}
+
+/**
+ * mm_set_root / mm_root: 힙 안의 블록 하나를 루트로 기록 / 다시 붙은 뒤 돌려받음. 루트는 오프셋이라 매핑 주소가 바뀌어도 됨.
+ * 공유 힙 빌드가 아니면 남길 곳이 없으니 -1 / NULL
+ */
+int mm_set_root(void *p) {
+#ifdef MM_SHARED
+    LOCK();
+    user_root = p;
+    UNLOCK();
+    return 0;
+#else
+    (void)p;
+    return -1;
+#endif
+}
+
+void *mm_root(void) {
+#ifdef MM_SHARED
+    void *p;
+
+    LOCK();
+    p = user_root;
+    UNLOCK();
+    return p;
+#else
+    return NULL;
+#endif
+}
+
+/* 진입 프로브는 락 잡기 전, 반환 프로브는 락 놓은 뒤라서 둘 사이 시간에 락 대기도 들어감 */
+void *mm_malloc(size_t size) {
+    void *bp;
 
+    PROBE(malloc_entry, size);
+    LOCK();
+    bp = malloc_block(size);
+    EVENT(MM_EV_MALLOC, size, bp, 0, 0);
+    UNLOCK();
+    PROBE(malloc_return, size, bp);
     return bp;
 }
 
+void mm_free(void *bp) {
+    PROBE(free_entry, bp, bp ? GET_SIZE(HDRP(bp)) : 0);
+    EVENT(MM_EV_FREE, bp ? GET_SIZE(HDRP(bp)) : 0, bp, 0, 0); // 블록은 아직 호출자 것이라 락 없이 읽어도 됨
+    if (deferred_on && !nursery_on) { // nursery/수명 추적은 락 안에서만 갱신하므로 지연 free에서 뺌
+        defer_free(bp);
+        PROBE(free_return, bp);
+        return;
+    }
+    LOCK();
+    free_block(bp);
+    UNLOCK();
+    PROBE(free_return, bp);
+}
+
+void *mm_realloc(void *ptr, size_t size) {
+    void *bp;
+
+    PROBE(realloc_entry, ptr, size);
+    LOCK();
+    bp = realloc_block(ptr, size);
+    EVENT(MM_EV_REALLOC, size, bp, 0, bp != NULL && bp == ptr);
+    UNLOCK();
+    PROBE(realloc_return, ptr, size, bp);
+    return bp;
+}
+
+mm_handle_t mm_halloc(size_t size) {
+    mm_handle_t h;
+
+    LOCK();
+    h = halloc_block(size);
+    UNLOCK();
+    return h;
+}
+
+void mm_hfree(mm_handle_t h) {
+    LOCK();
+    hfree_block(h);
+    UNLOCK();
+}
+
+/**
+ * mm_hlock / mm_hunlock: 블록을 고정하고 현재 주소를 돌려줌 / 고정 해제. 중첩 가능
+ */
+void *mm_hlock(mm_handle_t h) {
+    void *p;
+
+    LOCK();
+    HSLOT(h)->lock++;
+    p = HPAYLOAD(HSLOT(h)->bp);
+    UNLOCK();
+    return p;
+}
+
+void mm_hunlock(mm_handle_t h) {
+    LOCK();
+    HSLOT(h)->lock--;
+    UNLOCK();
+}
+
+size_t mm_compact(size_t budget) {
+#ifdef MM_SHARED
+    (void)budget;
+    return 0; // 핸들 블록이 없으니 옮길 것도 없음
+#else
+    size_t moved;
+
+    LOCK();
+    moved = compact_heap(budget);
+    UNLOCK();
+    return moved;
+#endif
+}
+
 
 /* ========================== Debugging Functions =============================== */
 #ifdef DEBUG
@@ -481,7 +2459,7 @@ static void mm_checkheap(int line) {
         }
 
         /* 1-B. 정렬 검사 */
-        if (((uintptr_t)bp % ALIGNMENT) != 0) {
+        if (((uintptr_t)bp % DRIVER_ALIGN) != 0) {
             fprintf(stderr, "❌ Alignment error at %p\n", bp);
             errors++;
         }
@@ -525,6 +2503,12 @@ static void mm_checkheap(int line) {
                 fprintf(stderr, "❌ Free-list block %p marked allocated\n", f);
                 errors++;
             }
+            /* 3-A'. 노드 안의 크기 사본 (MM_SIZE_CACHE) */
+            if (GET_NODE_SIZE(f) != GET_SIZE(HDRP(f))) {
+                fprintf(stderr, "❌ Free-list block %p caches size %zu, header says %zu\n",
+                        f, (size_t)GET_NODE_SIZE(f), (size_t)GET_SIZE(HDRP(f)));
+                errors++;
+            }
             /* 3-B. 경계 검사 */
             if ((char *)HDRP(f) < (char *)mem_heap_lo() ||
                 (char *)FTRP(f) > (char *)mem_heap_hi()) {
@@ -541,6 +2525,17 @@ static void mm_checkheap(int line) {
                 fprintf(stderr, "❌ Pred/Succ mismatch: succ(%p)->pred != %p\n", s, f);
                 errors++;
             }
+#ifdef MM_SIZE_INDEX
+            /* 3-C'. 인덱스의 칸 */
+            {
+                struct idx_class *k = &idx_class[size_class(GET_SIZE(HDRP(f)))];
+                size_t i = IDX_POS(f);
+                if (i >= k->n || idx_base + k->off[i] != (char *)f || k->size[i] != GET_SIZE(HDRP(f))) {
+                    fprintf(stderr, "❌ Free-list block %p has a stale index entry\n", f);
+                    errors++;
+                }
+            }
+#endif
             /* 3-D. 무한 루프 방지 */
             if (++count > MAX_HEAP_BLOCKS) {
                 fprintf(stderr, "❌ Free-list cycle detected\n");
@@ -548,6 +2543,22 @@ static void mm_checkheap(int line) {
                 break;
             }
         }
+#ifdef MM_SIZE_INDEX
+        {
+            size_t total = 0;
+            for (int c = 0; c < IDX_CLASSES; c++) {
+                if (idx_class[c].n > idx_class[c].cap) {
+                    fprintf(stderr, "❌ Index class %d over capacity\n", c);
+                    errors++;
+                }
+                total += idx_class[c].n;
+            }
+            if (total != (size_t)count) {
+                fprintf(stderr, "❌ Index holds %zu blocks, free list %d\n", total, count);
+                errors++;
+            }
+        }
+#endif
     }
 
     /* 4. 힙상의 모든 free 블록이 리스트에 있어야 함 */
@@ -5,6 +5,235 @@ extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
 
+/*
+ * Placement policies used by find_fit. The policy passed to
+ * mm_set_fit_policy takes effect at the next mm_init.
+ */
+typedef enum {
+    MM_FIT_FIRST,    /* first fit from the head of the free list */
+    MM_FIT_NEXT,     /* next fit from a roving pointer (default) */
+    MM_FIT_BEST,     /* smallest fitting block in the whole free list */
+    MM_FIT_GOOD,     /* smallest of the first few fitting blocks */
+    MM_FIT_ADAPTIVE  /* switch between the above based on online samples */
+} mm_fit_policy_t;
+
+extern int mm_set_fit_policy(mm_fit_policy_t policy);
+
+/*
+ * Split policies used by place when a free block is larger than the
+ * request.
+ */
+typedef enum {
+    MM_PLACE_LOW,       /* allocate the low end, free the high end (default) */
+    MM_PLACE_TWO_ENDED  /* small requests from the low end, large from the high end */
+} mm_place_policy_t;
+
+extern int mm_set_place_policy(mm_place_policy_t policy);
+
+/*
+ * find_fit profiling. When enabled (at the next mm_init), every free
+ * list search is timed with the cycle counter; the nodes visited are
+ * counted as well, so cycles/visits is the cost of one step of the
+ * traversal. mdriver -F prints it per trace.
+ */
+typedef struct {
+    size_t fits;                 /* find_fit calls */
+    size_t visits;               /* free list nodes visited */
+    unsigned long long cycles;   /* cycles spent in find_fit */
+} mm_fit_stats_t;
+
+extern int mm_set_fit_profile(int enable);
+extern void mm_fit_stats(mm_fit_stats_t *st);
+
+/*
+ * Phase cost profiling. When enabled (at the next mm_init), the
+ * allocator times its phases with the cycle counter: the free list
+ * search (find_fit), taking and splitting the fit (place), coalescing,
+ * growing the heap (extend_heap, not counting the coalesce it ends
+ * with) and the copy of a realloc that moves. Phases nest inside the
+ * public calls, so their sum is less than the time of the ops that ran
+ * them. mdriver -C runs one extra pass with it and prints the phases
+ * next to the cycles spent per op type.
+ */
+enum {
+    MM_PHASE_SEARCH,
+    MM_PHASE_SPLIT,
+    MM_PHASE_COALESCE,
+    MM_PHASE_EXTEND,
+    MM_PHASE_COPY,
+    MM_PHASES
+};
+
+typedef struct {
+    unsigned long long cycles[MM_PHASES]; /* cycles spent per phase */
+    size_t calls[MM_PHASES];              /* times each phase ran */
+    size_t copy_bytes;                    /* bytes copied by realloc */
+} mm_phase_stats_t;
+
+extern int mm_set_phase_profile(int enable);
+extern void mm_phase_stats(mm_phase_stats_t *st);
+
+/*
+ * Heap introspection. The counters (extend_calls, fit_search,
+ * coalesce) are always kept and cost an increment each; they count
+ * from the last mm_init. The free list breakdown is computed by
+ * walking the free list when mm_stats is called. Live blocks are the
+ * allocated heap blocks; with the nursery on, its objects live inside
+ * one such block.
+ */
+#define MM_STATS_CLASSES 16  /* class c: free blocks of [2^(c+5), 2^(c+6)) bytes; the last has the rest */
+#define MM_STATS_SEARCHES 16 /* bucket 0: no node visited, bucket b: [2^(b-1), 2^b) nodes; the last has the rest */
+
+typedef struct mm_stats {
+    size_t heap_size;                        /* bytes from mem_heap_lo to mem_heap_hi */
+    size_t live_bytes;                       /* bytes in allocated blocks, headers included */
+    size_t live_blocks;
+    size_t free_bytes;                       /* bytes in free blocks */
+    size_t free_blocks;
+    size_t free_by_class[MM_STATS_CLASSES];  /* free bytes per size class */
+    size_t largest_free;                     /* size of the largest free block */
+    double ext_frag;                         /* 1 - largest_free / free_bytes */
+    size_t extend_calls;                     /* extend_heap (sbrk) calls */
+    size_t fit_search[MM_STATS_SEARCHES];    /* find_fit calls by nodes visited */
+    size_t coalesce[4];                      /* coalesce calls: [0] no free neighbour, [1] next free,
+                                                [2] previous free, [3] both */
+} mm_stats_t;
+
+extern void mm_stats(struct mm_stats *st);
+
+/*
+ * Sampling heap profiler. With mm_set_heap_sampling(n) (at the next
+ * mm_init), mm_malloc samples about one allocation per n requested
+ * bytes; the gaps between samples are drawn from an exponential
+ * distribution, so every byte is equally likely to be picked. A sample
+ * records the request size and a backtrace, and mm_free drops it again.
+ * mm_heap_profile writes the samples grouped by stack in the text format
+ * of gperftools heap profiles ("heap_v2"), which pprof reads: the in-use
+ * columns are the live heap, the allocated columns everything sampled
+ * since mm_init (pprof -inuse_space / -alloc_space). n = 0 turns the
+ * sampling off; mm_heap_profile then returns -1.
+ */
+extern int mm_set_heap_sampling(size_t bytes);
+extern int mm_heap_profile(FILE *fp);
+
+/*
+ * Lifetime prediction. When enabled (at the next mm_init), small
+ * requests whose size has recently produced short-lived blocks are
+ * bump-allocated from a nursery region that is reclaimed in bulk once
+ * it empties. Prediction outcomes are counted for every lifetime the
+ * allocator observes. mm_set_nursery returns -1 if there is no nursery
+ * to enable (mm.c built with -DMM_SHARED, the buddy and mm-cfg engines).
+ */
+typedef struct {
+    size_t short_right;    /* predicted short-lived, died young */
+    size_t short_wrong;    /* predicted short-lived, lived long */
+    size_t long_right;     /* predicted long-lived, lived long */
+    size_t long_wrong;     /* predicted long-lived, died young */
+    size_t nursery_allocs; /* allocations served from the nursery */
+    size_t nursery_resets; /* times the empty nursery was reclaimed */
+} mm_lifetime_stats_t;
+
+extern int mm_set_nursery(int enable);
+extern void mm_lifetime_stats(mm_lifetime_stats_t *st);
+
+/*
+ * Regions (arenas). Objects are bump-allocated from large blocks taken
+ * with mm_malloc and cannot be freed one by one; mm_region_reset
+ * releases all of them at once and mm_region_destroy also releases the
+ * region itself. Implemented in mm-region.c on top of the functions
+ * above, so it works with any allocator engine.
+ */
+typedef struct mm_region mm_region_t;
+
+extern mm_region_t *mm_region_create(void);
+extern void *mm_region_alloc(mm_region_t *r, size_t size);
+extern void mm_region_reset(mm_region_t *r);
+extern void mm_region_destroy(mm_region_t *r);
+
+/*
+ * Fixed-size object pools. Slabs are taken with mm_malloc and carved
+ * into objects of one size; free objects are kept on an intrusive
+ * list, so get and put are a pointer pop and push with no per-object
+ * header. Slabs go back to the heap only in mm_pool_destroy.
+ * Implemented in mm-pool.c.
+ */
+typedef struct mm_pool mm_pool_t;
+
+typedef struct {
+    size_t objsize;    /* object size after rounding up to the alignment */
+    size_t slabs;      /* slabs taken from the heap */
+    size_t capacity;   /* objects the slabs can hold */
+    size_t in_use;     /* objects currently handed out */
+    size_t high_water; /* largest in_use seen */
+} mm_pool_stats_t;
+
+extern mm_pool_t *mm_pool_create(size_t objsize, size_t align);
+extern void *mm_pool_get(mm_pool_t *p);
+extern void mm_pool_put(mm_pool_t *p, void *obj);
+extern void mm_pool_destroy(mm_pool_t *p);
+extern void mm_pool_stats(mm_pool_t *p, mm_pool_stats_t *st);
+
+/*
+ * Movable allocations. mm_halloc returns a handle (0 on failure)
+ * instead of a pointer; mm_hlock pins the object and returns its
+ * current address, which stays valid until the matching mm_hunlock.
+ * mm_compact slides unlocked objects toward mem_heap_lo(), fixes up
+ * their handles, and trims the brk when a pass over the heap finishes.
+ * With budget > 0 it stops after moving about budget bytes and resumes
+ * there on the next call; with budget 0 it finishes the pass. Returns
+ * the number of bytes moved. The slot table is process-local, so with
+ * -DMM_SHARED mm_halloc always returns 0 and mm_compact moves nothing;
+ * the buddy and mm-cfg engines behave the same way.
+ */
+typedef size_t mm_handle_t; /* 0 is never a valid handle */
+
+extern mm_handle_t mm_halloc(size_t size);
+extern void mm_hfree(mm_handle_t h);
+extern void *mm_hlock(mm_handle_t h);
+extern void mm_hunlock(mm_handle_t h);
+extern size_t mm_compact(size_t budget);
+
+/*
+ * Deferred free, available when mm.c is built with -DMM_THREADS (which
+ * also makes every entry point take a heap lock). When enabled (at the
+ * next mm_init), mm_free pushes the block onto a lock-free pending
+ * queue, and a background thread coalesces the queued blocks back into
+ * the free list. If malloc finds no fit, it drains the queue itself
+ * before growing the heap. The lag is the time from mm_free until the
+ * block is reusable. mm_set_deferred_free returns -1 in builds without
+ * thread support.
+ */
+typedef struct {
+    size_t deferred;   /* frees pushed onto the pending queue */
+    size_t drained_bg; /* queued blocks coalesced by the background thread */
+    size_t drained_fg; /* queued blocks coalesced by malloc itself */
+    size_t fg_drains;  /* times malloc drained the queue to find a fit */
+    double lag_avg_us; /* mean free-to-reusable lag in microseconds */
+    double lag_max_us; /* largest such lag */
+} mm_deferred_stats_t;
+
+extern int mm_set_deferred_free(int enable);
+extern void mm_deferred_stats(mm_deferred_stats_t *st);
+
+/*
+ * Persistent heap. With memlib's mem_init_file and mm.c built with
+ * -DMM_SHARED, mm_init reattaches to the heap left in the file by the
+ * previous run instead of formatting a new one. mm_shutdown marks the
+ * heap clean and flushes it. If the mark is missing (the previous run
+ * crashed), mm_init first undoes the call the crash interrupted (each
+ * call logs the heap words it overwrites in the segment header), then
+ * checks the block structure and rebuilds the free list from the
+ * boundary tags, and mm_was_recovered returns 1.
+ * mm_set_root records one block as the heap's root (kept as an offset,
+ * like the free list), and mm_root returns it after a restart, so a
+ * program can find its data again. Without -DMM_SHARED there is nowhere
+ * to keep it: mm_set_root returns -1 and mm_root NULL.
+ */
+extern void mm_shutdown(void);
+extern int mm_was_recovered(void);
+extern int mm_set_root(void *p);
+extern void *mm_root(void);
+
 
 /* 
  * Students work in teams of one or two.  Teams enter their team name, 
@@ -81,6 +81,11 @@ while ($line = <STDIN>) {
     # save the line for output later
     $lines[$requestnum++] = $line;
 
+    # region annotations (g <region> <id>) are not requests
+    if ($cmd eq "g") {
+	next;
+    }
+
     #ignore realloc requests, as long as they are preceeded by an alloc request
     if ($cmd eq "r") {
 	if (!$HASH{$id}) {
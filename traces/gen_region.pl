@@ -0,0 +1,72 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+#
+# gen_region.pl - request-handler style trace for the region API.
+#
+# Each request allocates a batch of small short-lived objects and frees
+# all of them when it finishes. The objects of request r are grouped
+# into region r with "g <region> <id>" annotations, which mdriver -R
+# uses to route them through mm_region_alloc/mm_region_reset. A pool
+# of long-lived cache entries is replaced now and then between requests.
+#
+
+$out_filename = "region.rep";
+$num_requests = 200;
+$max_objs = 120;
+$max_obj_size = 256;
+$num_cache = 64;
+$cache_size = 512;
+
+srand(15213);
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+$id = 0;
+@lines = ();
+
+# Long-lived cache entries
+for ($i = 0; $i < $num_cache; $i += 1) {
+    $cache[$i] = $id;
+    push @lines, "a $id " . (int(rand $cache_size) + 1);
+    $id += 1;
+}
+
+for ($r = 0; $r < $num_requests; $r += 1) {
+    @objs = ();
+    $nobjs = int(rand $max_objs) + 8;
+    for ($i = 0; $i < $nobjs; $i += 1) {
+        push @lines, "g $r $id";
+        push @lines, "a $id " . (int(rand $max_obj_size) + 1);
+        push @objs, $id;
+        $id += 1;
+    }
+
+    # Evict one cache entry now and then
+    if (rand() < 0.5) {
+        $slot = int(rand $num_cache);
+        push @lines, "f $cache[$slot]";
+        $cache[$slot] = $id;
+        push @lines, "a $id " . (int(rand $cache_size) + 1);
+        $id += 1;
+    }
+
+    # The request is done: free everything it allocated
+    foreach $obj (@objs) {
+        push @lines, "f $obj";
+    }
+}
+
+# Count the requests (annotations are not requests)
+$num_ops = grep { !/^g / } @lines;
+
+print OUTFILE "$id\n";
+print OUTFILE "$id\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+foreach $line (@lines) {
+    print OUTFILE "$line\n";
+}
+
+close OUTFILE;